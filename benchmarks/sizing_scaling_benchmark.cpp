@@ -0,0 +1,242 @@
+// standalone thread scaling and numa benchmark for batch sizing, build it against the same dependencies as the
+// library and run it with no arguments, results go to stdout as csv
+
+#include "../numa_partitioned_sizer.hpp"
+#include "../screen_space_sizer.hpp"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <chrono>
+#include <iostream>
+#include <ostream>
+#include <random>
+
+// measures how batch sizing scales with threads on generated scenes shaped like real content. scenes are built from
+// world space boxes with identity transforms and laid out in front of a camera at the origin looking down -z, so place
+// the sizer's camera accordingly. bandwidth is estimated from the bytes each sized object reads and writes, it is not
+// a hardware counter
+class SizingScalingBenchmark {
+  public:
+    enum class Scene { InstancedForest, City, PointCloud };
+
+    struct Row {
+        Scene scene;
+        std::size_t object_count;
+        unsigned int thread_count;
+        double seconds;
+        double objects_per_second;
+        // throughput relative to thread_count times the single thread throughput of the same scene and size
+        double scaling_efficiency;
+        double estimated_bandwidth_gb_per_s;
+    };
+
+    struct Settings {
+        std::vector<Scene> scenes = {Scene::InstancedForest, Scene::City, Scene::PointCloud};
+        std::vector<std::size_t> object_counts = {10'000, 100'000, 1'000'000, 10'000'000};
+        // empty means powers of two up to the hardware thread count, plus the thread count itself. a single thread
+        // run is always added as the scaling baseline
+        std::vector<unsigned int> thread_counts;
+        // each measurement is the best of this many runs
+        unsigned int repetitions = 3;
+        float scene_extent = 2000.0f;
+        std::uint32_t seed = 1;
+    };
+
+    static const char *get_scene_name(Scene scene) {
+        switch (scene) {
+        case Scene::InstancedForest:
+            return "instanced forest";
+        case Scene::City:
+            return "city";
+        case Scene::PointCloud:
+            return "point cloud";
+        }
+        return "unknown";
+    }
+
+    static std::vector<vertex_geometry::AxisAlignedBoundingBox> generate_scene(Scene scene, std::size_t object_count,
+                                                                                float extent, std::uint32_t seed) {
+        std::mt19937 rng(seed);
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+        auto ground_position = [&] {
+            return glm::vec3((unit(rng) - 0.5f) * extent, 0.0f, -unit(rng) * extent);
+        };
+
+        std::vector<vertex_geometry::AxisAlignedBoundingBox> boxes;
+        boxes.reserve(object_count);
+        for (std::size_t i = 0; i < object_count; ++i) {
+            glm::vec3 min, max;
+            switch (scene) {
+            case Scene::InstancedForest: {
+                // many copies of a few tree shapes at varied scale
+                glm::vec3 base = ground_position();
+                float scale = 0.5f + unit(rng);
+                glm::vec3 half_extents = glm::vec3(1.5f, 0.0f, 1.5f) * scale;
+                min = base - half_extents;
+                max = base + half_extents + glm::vec3(0.0f, (6.0f + 4.0f * static_cast<float>(i % 4)) * scale, 0.0f);
+                break;
+            }
+            case Scene::City: {
+                // buildings on a regular grid with a long tail of tall towers
+                std::size_t blocks_per_side = static_cast<std::size_t>(std::ceil(std::sqrt(object_count)));
+                float spacing = extent / static_cast<float>(blocks_per_side);
+                glm::vec3 base((static_cast<float>(i % blocks_per_side) + 0.5f) * spacing - 0.5f * extent, 0.0f,
+                               -(static_cast<float>(i / blocks_per_side) + 0.5f) * spacing);
+                float footprint = 0.35f * spacing * (0.5f + 0.5f * unit(rng));
+                float height = 5.0f + 200.0f * std::pow(unit(rng), 6.0f);
+                min = base - glm::vec3(footprint, 0.0f, footprint);
+                max = base + glm::vec3(footprint, height, footprint);
+                break;
+            }
+            case Scene::PointCloud: {
+                // tiny splats filling a volume, mostly sub pixel
+                glm::vec3 center = ground_position() + glm::vec3(0.0f, unit(rng) * 0.1f * extent, 0.0f);
+                min = center - glm::vec3(0.02f);
+                max = center + glm::vec3(0.02f);
+                break;
+            }
+            }
+            boxes.emplace_back(std::vector<glm::vec3>{min, max});
+        }
+        return boxes;
+    }
+
+    static std::vector<Row> run(const ScreenSpaceSizer &sizer) { return run(sizer, Settings()); }
+
+    static std::vector<Row> run(const ScreenSpaceSizer &sizer, const Settings &settings) {
+        LogSection _(global_logger, "sizing scaling benchmark");
+
+        std::vector<unsigned int> thread_counts = settings.thread_counts;
+        if (thread_counts.empty()) {
+            unsigned int hardware_threads = std::max(1u, std::thread::hardware_concurrency());
+            for (unsigned int t = 1; t < hardware_threads; t *= 2)
+                thread_counts.push_back(t);
+            thread_counts.push_back(hardware_threads);
+        }
+        // scaling efficiency is relative to one thread, so that is always measured first whatever was asked for
+        std::erase_if(thread_counts, [](unsigned int t) { return t <= 1; });
+        thread_counts.insert(thread_counts.begin(), 1u);
+
+        constexpr double bytes_per_object = sizeof(vertex_geometry::AxisAlignedBoundingBox) + sizeof(Transform) +
+                                            sizeof(ScreenSpaceSizer::SizingResult);
+
+        std::vector<Row> rows;
+        for (Scene scene : settings.scenes) {
+            for (std::size_t object_count : settings.object_counts) {
+                auto boxes = generate_scene(scene, object_count, settings.scene_extent, settings.seed);
+                std::vector<Transform> transforms(object_count);
+                std::vector<ScreenSpaceSizer::SizingResult> results;
+                ScreenSpaceSizer::SizingSnapshot snapshot = sizer.take_snapshot();
+
+                double single_thread_throughput = 0.0;
+                for (unsigned int thread_count : thread_counts) {
+                    // the first run also faults in the result buffer, so it only counts if it is the best
+                    double best_seconds = std::numeric_limits<double>::max();
+                    for (unsigned int r = 0; r < std::max(1u, settings.repetitions); ++r) {
+                        auto start = std::chrono::steady_clock::now();
+                        sizer.size_batch_parallel(snapshot, boxes, transforms, results, thread_count);
+                        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+                        best_seconds = std::min(best_seconds, elapsed.count());
+                    }
+
+                    Row row;
+                    row.scene = scene;
+                    row.object_count = object_count;
+                    row.thread_count = thread_count;
+                    row.seconds = best_seconds;
+                    row.objects_per_second = static_cast<double>(object_count) / std::max(best_seconds, 1e-9);
+                    if (thread_count == 1)
+                        single_thread_throughput = row.objects_per_second;
+                    row.scaling_efficiency = row.objects_per_second / (single_thread_throughput * thread_count);
+                    row.estimated_bandwidth_gb_per_s = row.objects_per_second * bytes_per_object / 1e9;
+                    rows.push_back(row);
+                }
+            }
+        }
+        return rows;
+    }
+
+    struct NumaComparison {
+        std::size_t object_count;
+        std::size_t node_count;
+        // one shared array first touched by the calling thread, sized with unpinned threads
+        double shared_array_seconds;
+        // node local partitions sized by pinned threads
+        double numa_partitioned_seconds;
+    };
+
+    static NumaComparison run_numa_comparison(const ScreenSpaceSizer &sizer, Scene scene = Scene::City,
+                                              std::size_t object_count = 10'000'000, unsigned int repetitions = 3,
+                                              float scene_extent = 2000.0f) {
+        LogSection _(global_logger, "numa comparison");
+
+        NumaTopology topology = NumaTopology::detect();
+        auto boxes = generate_scene(scene, object_count, scene_extent, 1);
+        std::vector<Transform> transforms(object_count);
+        // both paths read precomposed matrices so the only difference is memory placement and thread pinning
+        std::vector<glm::mat4> model_matrices(object_count);
+        for (std::size_t i = 0; i < object_count; ++i)
+            model_matrices[i] = transforms[i].get_transform_matrix();
+        std::vector<ScreenSpaceSizer::SizingResult> results(object_count);
+        ScreenSpaceSizer::SizingSnapshot snapshot = sizer.take_snapshot();
+        unsigned int thread_count = static_cast<unsigned int>(topology.cpu_count());
+
+        auto best_of = [&](auto &&fn) {
+            double best = std::numeric_limits<double>::max();
+            for (unsigned int r = 0; r < std::max(1u, repetitions); ++r) {
+                auto start = std::chrono::steady_clock::now();
+                fn();
+                std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+                best = std::min(best, elapsed.count());
+            }
+            return best;
+        };
+
+        NumaPartitionedSizer numa_sizer(topology);
+        numa_sizer.load(boxes, transforms);
+
+        NumaComparison comparison;
+        comparison.object_count = object_count;
+        comparison.node_count = topology.cpus_per_node.size();
+        comparison.shared_array_seconds = best_of([&] {
+            parallel_for_chunks(object_count, thread_count, [&](std::size_t begin, std::size_t end, std::size_t) {
+                for (std::size_t i = begin; i < end; ++i)
+                    results[i] = ScreenSpaceSizer::compute_sizing_result(snapshot, boxes[i], model_matrices[i]);
+            });
+        });
+        comparison.numa_partitioned_seconds = best_of([&] { numa_sizer.size(snapshot); });
+        return comparison;
+    }
+
+    static void print_report(const std::vector<Row> &rows, std::ostream &out) {
+        out << "scene, objects, threads, seconds, objects/s, scaling efficiency, est. GB/s\n";
+        for (const auto &row : rows) {
+            out << get_scene_name(row.scene) << ", " << row.object_count << ", " << row.thread_count << ", "
+                << row.seconds << ", " << row.objects_per_second << ", " << row.scaling_efficiency << ", "
+                << row.estimated_bandwidth_gb_per_s << "\n";
+        }
+    }
+};
+
+// fixed camera at the origin looking down -z, which is where generate_scene lays out its content
+class BenchmarkCamera : public ICamera {
+  public:
+    glm::mat4 get_view_matrix() const override { return glm::mat4(1.0f); }
+    glm::mat4 get_projection_matrix() const override {
+        return glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 5000.0f);
+    }
+};
+
+int main() {
+    BenchmarkCamera camera;
+    unsigned int screen_width_px = 1920, screen_height_px = 1080;
+    ScreenSpaceSizer sizer(camera, screen_width_px, screen_height_px);
+
+    SizingScalingBenchmark::print_report(SizingScalingBenchmark::run(sizer), std::cout);
+
+    auto comparison = SizingScalingBenchmark::run_numa_comparison(sizer);
+    std::cout << "\nnuma nodes, objects, shared array seconds, numa partitioned seconds\n"
+              << comparison.node_count << ", " << comparison.object_count << ", " << comparison.shared_array_seconds
+              << ", " << comparison.numa_partitioned_seconds << "\n";
+    return 0;
+}
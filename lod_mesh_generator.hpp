@@ -0,0 +1,345 @@
+#ifndef LOD_MESH_GENERATOR_HPP
+#define LOD_MESH_GENERATOR_HPP
+
+#include "screen_space_sizer.hpp"
+
+#include <algorithm>
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// quadric error edge collapse simplification (garland and heckbert). each collapse moves the surviving vertex to
+// whichever of the two endpoints or their midpoint has the lowest error, collapses that would flip a triangle are
+// skipped. edges used by a single triangle are boundaries and get a heavily weighted perpendicular plane quadric so
+// open meshes keep their silhouette instead of shrinking
+inline draw_info::IndexedVertexPositions simplify_quadric_error(const std::vector<glm::vec3> &xyz_positions,
+                                                                const std::vector<unsigned int> &indices,
+                                                                std::size_t target_triangle_count) {
+    // symmetric 4x4 error quadric stored as its upper triangle
+    using Quadric = std::array<double, 10>;
+
+    auto weighted_plane_quadric = [](const glm::vec3 &n, const glm::vec3 &point, double weight) {
+        double x = n.x, y = n.y, z = n.z, w = -glm::dot(n, point);
+        return Quadric{weight * x * x, weight * x * y, weight * x * z, weight * x * w, weight * y * y,
+                       weight * y * z, weight * y * w, weight * z * z, weight * z * w, weight * w * w};
+    };
+    auto plane_quadric = [&](const glm::vec3 &a, const glm::vec3 &b, const glm::vec3 &c) {
+        glm::vec3 n = glm::cross(b - a, c - a);
+        float length = glm::length(n);
+        if (length <= 0.0f)
+            return Quadric{};
+        // weight by area so large faces dominate
+        return weighted_plane_quadric(n / length, a, 0.5 * length);
+    };
+    // plane through a boundary edge perpendicular to its face, so collapses that pull the boundary inward or
+    // along its normal cost a lot more than collapses along it
+    auto boundary_quadric = [&](const glm::vec3 &a, const glm::vec3 &b, const glm::vec3 &c) {
+        constexpr double boundary_weight = 1000.0;
+        glm::vec3 edge = b - a;
+        glm::vec3 n = glm::cross(edge, glm::cross(edge, c - a));
+        float length = glm::length(n);
+        if (length <= 0.0f)
+            return Quadric{};
+        return weighted_plane_quadric(n / length, a, boundary_weight * glm::dot(edge, edge));
+    };
+    auto quadric_error = [](const Quadric &q, const glm::vec3 &p) {
+        double x = p.x, y = p.y, z = p.z;
+        return q[0] * x * x + 2 * q[1] * x * y + 2 * q[2] * x * z + 2 * q[3] * x + q[4] * y * y + 2 * q[5] * y * z +
+               2 * q[6] * y + q[7] * z * z + 2 * q[8] * z + q[9];
+    };
+
+    std::vector<glm::vec3> positions = xyz_positions;
+    std::vector<std::array<unsigned int, 3>> triangles(indices.size() / 3);
+    for (std::size_t t = 0; t < triangles.size(); ++t)
+        triangles[t] = {indices[t * 3], indices[t * 3 + 1], indices[t * 3 + 2]};
+
+    std::vector<Quadric> quadrics(positions.size(), Quadric{});
+    std::vector<std::vector<std::uint32_t>> vertex_triangles(positions.size());
+    std::vector<bool> triangle_alive(triangles.size(), true);
+    std::size_t alive_count = triangles.size();
+
+    for (std::size_t t = 0; t < triangles.size(); ++t) {
+        const auto &tri = triangles[t];
+        Quadric q = plane_quadric(positions[tri[0]], positions[tri[1]], positions[tri[2]]);
+        for (unsigned int v : tri) {
+            for (std::size_t k = 0; k < q.size(); ++k)
+                quadrics[v][k] += q[k];
+            vertex_triangles[v].push_back(static_cast<std::uint32_t>(t));
+        }
+    }
+
+    struct Collapse {
+        double cost;
+        unsigned int v0, v1;
+        std::uint32_t version0, version1;
+        glm::vec3 target;
+        bool operator>(const Collapse &other) const { return cost > other.cost; }
+    };
+
+    std::vector<std::uint32_t> versions(positions.size(), 0);
+    std::vector<bool> vertex_alive(positions.size(), true);
+    std::priority_queue<Collapse, std::vector<Collapse>, std::greater<>> queue;
+
+    auto push_edge = [&](unsigned int v0, unsigned int v1) {
+        Quadric q;
+        for (std::size_t k = 0; k < q.size(); ++k)
+            q[k] = quadrics[v0][k] + quadrics[v1][k];
+        std::array<glm::vec3, 3> candidates = {positions[v0], positions[v1], (positions[v0] + positions[v1]) * 0.5f};
+        Collapse best{std::numeric_limits<double>::max(), v0, v1, versions[v0], versions[v1], candidates[0]};
+        for (const auto &candidate : candidates) {
+            double cost = quadric_error(q, candidate);
+            if (cost < best.cost) {
+                best.cost = cost;
+                best.target = candidate;
+            }
+        }
+        queue.push(best);
+    };
+
+    // undirected edges with the triangle that produced them, so winding doesn't decide which edges get queued and
+    // edges owned by a single triangle can be found as boundaries
+    struct Edge {
+        unsigned int v0, v1;
+        std::uint32_t triangle;
+    };
+    std::vector<Edge> edges;
+    edges.reserve(triangles.size() * 3);
+    for (std::size_t t = 0; t < triangles.size(); ++t) {
+        for (int e = 0; e < 3; ++e) {
+            auto [v0, v1] = std::minmax(triangles[t][e], triangles[t][(e + 1) % 3]);
+            if (v0 != v1)
+                edges.push_back({v0, v1, static_cast<std::uint32_t>(t)});
+        }
+    }
+    std::sort(edges.begin(), edges.end(),
+              [](const Edge &a, const Edge &b) { return a.v0 != b.v0 ? a.v0 < b.v0 : a.v1 < b.v1; });
+
+    for (std::size_t i = 0; i < edges.size();) {
+        std::size_t j = i + 1;
+        while (j < edges.size() && edges[j].v0 == edges[i].v0 && edges[j].v1 == edges[i].v1)
+            ++j;
+        if (j - i == 1) {
+            const auto &tri = triangles[edges[i].triangle];
+            unsigned int opposite = tri[0];
+            for (unsigned int v : tri)
+                if (v != edges[i].v0 && v != edges[i].v1)
+                    opposite = v;
+            Quadric q = boundary_quadric(positions[edges[i].v0], positions[edges[i].v1], positions[opposite]);
+            for (unsigned int v : {edges[i].v0, edges[i].v1})
+                for (std::size_t k = 0; k < q.size(); ++k)
+                    quadrics[v][k] += q[k];
+        }
+        i = j;
+    }
+
+    for (std::size_t i = 0; i < edges.size(); ++i)
+        if (i == 0 || edges[i].v0 != edges[i - 1].v0 || edges[i].v1 != edges[i - 1].v1)
+            push_edge(edges[i].v0, edges[i].v1);
+
+    auto would_flip = [&](unsigned int moved, unsigned int other, const glm::vec3 &target) {
+        for (std::uint32_t t : vertex_triangles[moved]) {
+            if (!triangle_alive[t])
+                continue;
+            const auto &tri = triangles[t];
+            if (tri[0] == other || tri[1] == other || tri[2] == other)
+                continue; // collapses away
+            std::array<glm::vec3, 3> p = {positions[tri[0]], positions[tri[1]], positions[tri[2]]};
+            glm::vec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+            for (int k = 0; k < 3; ++k) {
+                if (tri[k] == moved)
+                    p[k] = target;
+            }
+            glm::vec3 after = glm::cross(p[1] - p[0], p[2] - p[0]);
+            if (glm::dot(before, after) <= 0.0f)
+                return true;
+        }
+        return false;
+    };
+
+    while (alive_count > target_triangle_count && !queue.empty()) {
+        Collapse collapse = queue.top();
+        queue.pop();
+
+        unsigned int v0 = collapse.v0, v1 = collapse.v1;
+        if (!vertex_alive[v0] || !vertex_alive[v1] || versions[v0] != collapse.version0 ||
+            versions[v1] != collapse.version1)
+            continue; // stale entry, the edge has been requeued with its current cost if it still exists
+
+        if (would_flip(v0, v1, collapse.target) || would_flip(v1, v0, collapse.target))
+            continue;
+
+        // merge v1 into v0
+        positions[v0] = collapse.target;
+        for (std::size_t k = 0; k < quadrics[v0].size(); ++k)
+            quadrics[v0][k] += quadrics[v1][k];
+        vertex_alive[v1] = false;
+        ++versions[v0];
+
+        for (std::uint32_t t : vertex_triangles[v1]) {
+            if (!triangle_alive[t])
+                continue;
+            auto &tri = triangles[t];
+            for (auto &v : tri) {
+                if (v == v1)
+                    v = v0;
+            }
+            if (tri[0] == tri[1] || tri[1] == tri[2] || tri[0] == tri[2]) {
+                triangle_alive[t] = false;
+                --alive_count;
+            } else {
+                vertex_triangles[v0].push_back(t);
+            }
+        }
+        vertex_triangles[v1].clear();
+        std::erase_if(vertex_triangles[v0], [&](std::uint32_t t) { return !triangle_alive[t]; });
+
+        for (std::uint32_t t : vertex_triangles[v0]) {
+            for (unsigned int v : triangles[t]) {
+                if (v != v0)
+                    push_edge(v0, v);
+            }
+        }
+    }
+
+    // compact down to the vertices that are still referenced
+    draw_info::IndexedVertexPositions simplified;
+    std::vector<unsigned int> remap(positions.size(), std::numeric_limits<unsigned int>::max());
+    for (std::size_t t = 0; t < triangles.size(); ++t) {
+        if (!triangle_alive[t])
+            continue;
+        for (unsigned int v : triangles[t]) {
+            if (remap[v] == std::numeric_limits<unsigned int>::max()) {
+                remap[v] = static_cast<unsigned int>(simplified.xyz_positions.size());
+                simplified.xyz_positions.push_back(positions[v]);
+            }
+            simplified.indices.push_back(remap[v]);
+        }
+    }
+    return simplified;
+}
+
+// generates lods on worker threads for meshes that ship without them and caches the results by mesh id. triangle
+// budgets come from the sizer's band thresholds, which bound an object's min pixel dimension, not its extent: a
+// budget of upper threshold squared times triangles_per_pixel is only right for roughly square footprints, and a
+// long thin object (say 4x400 px, Small) gets the same budget as a 4x4 one and will look coarse along its length
+class LODMeshGenerator {
+  public:
+    // indexed by ScreenSpaceSizer::Size, Large is always the original mesh
+    using LODSet = std::array<draw_info::IndexedVertexPositions, ScreenSpaceSizer::size_count>;
+
+    explicit LODMeshGenerator(unsigned int num_threads = std::max(1u, std::thread::hardware_concurrency() / 2),
+                              float triangles_per_pixel = 2.0f, std::size_t min_triangle_count = 8)
+        : triangles_per_pixel(triangles_per_pixel), min_triangle_count(min_triangle_count) {
+        for (unsigned int i = 0; i < std::max(1u, num_threads); ++i)
+            workers.emplace_back([this] { run_worker(); });
+    }
+
+    ~LODMeshGenerator() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        work_available.notify_all();
+        for (auto &worker : workers)
+            worker.join();
+    }
+
+    LODMeshGenerator(const LODMeshGenerator &) = delete;
+    LODMeshGenerator &operator=(const LODMeshGenerator &) = delete;
+
+    // budget for a roughly square object whose min pixel dimension sits at the top of the band; elongated objects
+    // are under-budgeted since the band says nothing about their max dimension
+    std::size_t get_triangle_budget(ScreenSpaceSizer::Size size) const {
+        float max_pixel_dimension = size == ScreenSpaceSizer::Size::Small
+                                        ? ScreenSpaceSizer::medium_min_pixel_dimension
+                                        : ScreenSpaceSizer::large_min_pixel_dimension;
+        return std::max(min_triangle_count,
+                        static_cast<std::size_t>(max_pixel_dimension * max_pixel_dimension * triangles_per_pixel));
+    }
+
+    // queues lod generation unless the mesh is already cached or queued, the geometry is copied so obj can change or
+    // go away afterwards
+    template <draw_info::IVPLike IVPX> void request_lods(std::uint64_t mesh_id, const IVPX &obj) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (cache.contains(mesh_id))
+            return;
+        cache.emplace(mesh_id, nullptr);
+        jobs.push_back({mesh_id, obj.xyz_positions, obj.indices});
+        work_available.notify_one();
+    }
+
+    // null until the lods for the mesh have been generated
+    std::shared_ptr<const LODSet> get_lods(std::uint64_t mesh_id) const {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = cache.find(mesh_id);
+        return it == cache.end() ? nullptr : it->second;
+    }
+
+    void evict(std::uint64_t mesh_id) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = cache.find(mesh_id);
+        // a mesh still being generated stays so the finished result has somewhere to go
+        if (it != cache.end() && it->second)
+            cache.erase(it);
+    }
+
+  private:
+    struct Job {
+        std::uint64_t mesh_id;
+        std::vector<glm::vec3> xyz_positions;
+        std::vector<unsigned int> indices;
+    };
+
+    float triangles_per_pixel;
+    std::size_t min_triangle_count;
+
+    mutable std::mutex mutex;
+    std::condition_variable work_available;
+    std::deque<Job> jobs;
+    std::unordered_map<std::uint64_t, std::shared_ptr<const LODSet>> cache;
+    bool stopping = false;
+    std::vector<std::thread> workers;
+
+    void run_worker() {
+        while (true) {
+            Job job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                work_available.wait(lock, [this] { return stopping || !jobs.empty(); });
+                if (stopping)
+                    return;
+                job = std::move(jobs.front());
+                jobs.pop_front();
+            }
+
+            auto lods = std::make_shared<LODSet>();
+            std::size_t triangle_count = job.indices.size() / 3;
+            for (std::size_t size = 0; size < ScreenSpaceSizer::size_count; ++size) {
+                std::size_t budget = size == static_cast<std::size_t>(ScreenSpaceSizer::Size::Large)
+                                         ? triangle_count
+                                         : get_triangle_budget(static_cast<ScreenSpaceSizer::Size>(size));
+                if (budget >= triangle_count) {
+                    (*lods)[size].xyz_positions = job.xyz_positions;
+                    (*lods)[size].indices = job.indices;
+                } else {
+                    (*lods)[size] = simplify_quadric_error(job.xyz_positions, job.indices, budget);
+                }
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+            cache[job.mesh_id] = std::move(lods);
+        }
+    }
+};
+
+#endif // LOD_MESH_GENERATOR_HPP
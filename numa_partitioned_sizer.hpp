@@ -0,0 +1,253 @@
+#ifndef NUMA_PARTITIONED_SIZER_HPP
+#define NUMA_PARTITIONED_SIZER_HPP
+
+#include "screen_space_sizer.hpp"
+
+#include <barrier>
+#include <cctype>
+#include <condition_variable>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+// cpus grouped by numa node, read from sysfs on linux. anywhere else, or when sysfs can't be read, everything is one
+// node holding every hardware thread
+struct NumaTopology {
+    std::vector<std::vector<unsigned int>> cpus_per_node;
+
+    static NumaTopology detect() {
+        NumaTopology topology;
+#ifdef __linux__
+        for (unsigned int node = 0;; ++node) {
+            std::ifstream cpulist("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+            if (!cpulist)
+                break;
+            std::string line;
+            std::getline(cpulist, line);
+            std::vector<unsigned int> cpus = parse_cpulist(line);
+            if (!cpus.empty())
+                topology.cpus_per_node.push_back(std::move(cpus));
+        }
+#endif
+        if (topology.cpus_per_node.empty()) {
+            topology.cpus_per_node.emplace_back();
+            for (unsigned int cpu = 0; cpu < std::max(1u, std::thread::hardware_concurrency()); ++cpu)
+                topology.cpus_per_node.back().push_back(cpu);
+        }
+        return topology;
+    }
+
+    // parses the kernel's list format, eg "0-7,16-23"
+    static std::vector<unsigned int> parse_cpulist(const std::string &list) {
+        std::vector<unsigned int> cpus;
+        std::stringstream stream(list);
+        std::string range;
+        while (std::getline(stream, range, ',')) {
+            if (range.empty() || !std::isdigit(static_cast<unsigned char>(range.front())))
+                continue;
+            std::size_t dash = range.find('-');
+            unsigned int first = static_cast<unsigned int>(std::stoul(range.substr(0, dash)));
+            unsigned int last =
+                dash == std::string::npos ? first : static_cast<unsigned int>(std::stoul(range.substr(dash + 1)));
+            for (unsigned int cpu = first; cpu <= last; ++cpu)
+                cpus.push_back(cpu);
+        }
+        return cpus;
+    }
+
+    std::size_t cpu_count() const {
+        std::size_t count = 0;
+        for (const auto &cpus : cpus_per_node)
+            count += cpus.size();
+        return count;
+    }
+
+    // best effort, returns false where thread affinity isn't supported
+    static bool pin_current_thread(const std::vector<unsigned int> &cpus) {
+#ifdef __linux__
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (unsigned int cpu : cpus)
+            CPU_SET(cpu, &set);
+        return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+        (void)cpus;
+        return false;
+#endif
+    }
+};
+
+// batch sizing for multi socket machines. objects are split into one contiguous range per numa node in proportion to
+// the node's cpus, and each range's inputs and results are allocated and first touched by threads pinned to that
+// node, so the sizing pass later reads and writes only node local memory. one worker per cpu is started and pinned
+// on construction and reused by every load and size call
+class NumaPartitionedSizer {
+  public:
+    struct NodePartition {
+        std::size_t first_object = 0;
+        std::vector<vertex_geometry::AxisAlignedBoundingBox> aabbs;
+        std::vector<glm::mat4> model_matrices;
+        std::vector<ScreenSpaceSizer::SizingResult> results;
+    };
+
+    explicit NumaPartitionedSizer(NumaTopology topology = NumaTopology::detect()) : topology(std::move(topology)) {
+        partitions.resize(this->topology.cpus_per_node.size());
+        for (std::size_t node = 0; node < this->topology.cpus_per_node.size(); ++node) {
+            for (std::size_t slot = 0; slot < this->topology.cpus_per_node[node].size(); ++slot)
+                workers.emplace_back([this, node, slot] { run_worker(node, slot); });
+        }
+    }
+
+    ~NumaPartitionedSizer() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        work_available.notify_all();
+        for (auto &worker : workers)
+            worker.join();
+    }
+
+    NumaPartitionedSizer(const NumaPartitionedSizer &) = delete;
+    NumaPartitionedSizer &operator=(const NumaPartitionedSizer &) = delete;
+
+    // copies the objects into node local storage, model matrices are captured now so call again when they change
+    void load(const std::vector<vertex_geometry::AxisAlignedBoundingBox> &aabbs, std::vector<Transform> &transforms) {
+        PROFILE_SECTION("numa load");
+
+        std::size_t count = std::min(aabbs.size(), transforms.size());
+        std::size_t total_cpus = std::max<std::size_t>(1, topology.cpu_count());
+        std::size_t first = 0;
+        for (std::size_t node = 0; node < partitions.size(); ++node) {
+            std::size_t share = node + 1 == partitions.size()
+                                    ? count - first
+                                    : count * topology.cpus_per_node[node].size() / total_cpus;
+            partitions[node].first_object = first;
+            first += share;
+        }
+
+        loaded_count = count;
+
+        auto allocate = [&](std::size_t node) {
+            NodePartition &partition = partitions[node];
+            std::size_t size = end_of(node) - partition.first_object;
+            // a fresh allocation made from a thread on the node, then filled by that node's threads
+            partition.aabbs = std::vector<vertex_geometry::AxisAlignedBoundingBox>(size);
+            partition.model_matrices = std::vector<glm::mat4>(size);
+            partition.results = std::vector<ScreenSpaceSizer::SizingResult>(size);
+        };
+        for_each_node_thread(allocate, [&](std::size_t node, std::size_t i) {
+            NodePartition &partition = partitions[node];
+            std::size_t local = i - partition.first_object;
+            partition.aabbs[local] = aabbs[i];
+            partition.model_matrices[local] = transforms[i].get_transform_matrix();
+        });
+    }
+
+    void size(const ScreenSpaceSizer::SizingSnapshot &snapshot) {
+        PROFILE_SECTION("numa size");
+        for_each_node_thread([](std::size_t) {}, [&](std::size_t node, std::size_t i) {
+            NodePartition &partition = partitions[node];
+            std::size_t local = i - partition.first_object;
+            partition.results[local] = ScreenSpaceSizer::compute_sizing_result(snapshot, partition.aabbs[local],
+                                                                               partition.model_matrices[local]);
+        });
+    }
+
+    const std::vector<NodePartition> &get_partitions() const { return partitions; }
+
+    const ScreenSpaceSizer::SizingResult &get_result(std::size_t object_index) const {
+        for (std::size_t node = partitions.size(); node-- > 0;) {
+            if (object_index >= partitions[node].first_object)
+                return partitions[node].results[object_index - partitions[node].first_object];
+        }
+        return partitions.front().results[object_index];
+    }
+
+  private:
+    NumaTopology topology;
+    std::vector<NodePartition> partitions;
+    std::size_t loaded_count = 0;
+
+    std::mutex mutex;
+    std::condition_variable work_available;
+    std::condition_variable work_finished;
+    // the job every worker runs once per generation, set for the duration of run_on_workers
+    const std::function<void(std::size_t, std::size_t)> *job = nullptr;
+    std::uint64_t generation = 0;
+    std::size_t pending_workers = 0;
+    bool stopping = false;
+    std::vector<std::thread> workers;
+
+    void run_worker(std::size_t node, std::size_t slot) {
+        NumaTopology::pin_current_thread(topology.cpus_per_node[node]);
+        std::uint64_t seen_generation = 0;
+        while (true) {
+            const std::function<void(std::size_t, std::size_t)> *current_job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                work_available.wait(lock, [&] { return stopping || generation != seen_generation; });
+                if (stopping)
+                    return;
+                seen_generation = generation;
+                current_job = job;
+            }
+
+            (*current_job)(node, slot);
+
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--pending_workers == 0)
+                work_finished.notify_one();
+        }
+    }
+
+    // runs fn(node, slot) once on every pinned worker and returns when all of them are done
+    void run_on_workers(const std::function<void(std::size_t, std::size_t)> &fn) {
+        std::unique_lock<std::mutex> lock(mutex);
+        job = &fn;
+        pending_workers = workers.size();
+        ++generation;
+        work_available.notify_all();
+        work_finished.wait(lock, [this] { return pending_workers == 0; });
+        job = nullptr;
+    }
+
+    std::size_t end_of(std::size_t node) const {
+        return node + 1 < partitions.size() ? partitions[node + 1].first_object : loaded_count;
+    }
+
+    // every pinned worker covers a contiguous slice of its node's object range. on_node_start runs on the node's
+    // first worker and every worker waits for all of them before the per object work starts
+    template <typename OnNodeStart, typename PerObject>
+    void for_each_node_thread(OnNodeStart &&on_node_start, PerObject &&per_object) {
+        if (workers.empty())
+            return;
+        std::barrier allocated(static_cast<std::ptrdiff_t>(workers.size()));
+
+        run_on_workers([&](std::size_t node, std::size_t slot) {
+            const auto &cpus = topology.cpus_per_node[node];
+            std::size_t node_begin = partitions[node].first_object;
+            std::size_t node_end = end_of(node);
+            std::size_t per_thread = (node_end - node_begin + cpus.size() - 1) / cpus.size();
+            std::size_t begin = std::min(node_end, node_begin + slot * per_thread);
+            std::size_t end = std::min(node_end, begin + per_thread);
+
+            if (slot == 0)
+                on_node_start(node);
+            allocated.arrive_and_wait();
+            for (std::size_t i = begin; i < end; ++i)
+                per_object(node, i);
+        });
+    }
+};
+
+#endif // NUMA_PARTITIONED_SIZER_HPP
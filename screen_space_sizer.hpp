@@ -3,11 +3,121 @@
 
 #include "sbpt_generated_includes.hpp"
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <barrier>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <future>
+#include <iterator>
+#include <limits>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// splits [0, count) into one contiguous chunk per thread and calls fn(begin, end, thread_index) for each, the calling
+// thread works on the first chunk. chunks never get smaller than min_chunk_size so small inputs stay single threaded
+template <typename Fn>
+void parallel_for_chunks(std::size_t count, unsigned int num_threads, Fn &&fn, std::size_t min_chunk_size = 1024) {
+    std::size_t max_threads = std::max<std::size_t>(1, count / std::max<std::size_t>(1, min_chunk_size));
+    std::size_t thread_count = std::clamp<std::size_t>(num_threads, 1, max_threads);
+    std::size_t chunk_size = (count + thread_count - 1) / thread_count;
+
+    std::vector<std::thread> threads;
+    for (std::size_t t = 1; t < thread_count; ++t) {
+        std::size_t begin = std::min(count, t * chunk_size);
+        threads.emplace_back([&fn, begin, end = std::min(count, begin + chunk_size), t] { fn(begin, end, t); });
+    }
+    fn(std::size_t{0}, std::min(count, chunk_size), std::size_t{0});
+    for (auto &thread : threads)
+        thread.join();
+}
 
 class ScreenSpaceSizer {
   public:
     enum class Size { Large, Medium, Small };
 
+    // number of entries in Size, for arrays indexed by band
+    static constexpr std::size_t size_count = 3;
+
+    // a band is used once the smallest projected side exceeds its threshold
+    static constexpr float large_min_pixel_dimension = 10.0f;
+    static constexpr float medium_min_pixel_dimension = 5.0f;
+
+    struct AABB2D {
+        glm::vec2 min;
+        glm::vec2 max;
+
+        float width() const { return std::max(0.0f, max.x - min.x); }
+
+        float height() const { return std::max(0.0f, max.y - min.y); }
+
+        float area() const { return width() * height(); }
+
+        float min_dimension() const { return std::min(width(), height()); }
+
+        float max_dimension() const { return std::max(width(), height()); }
+    };
+
+    // eye tracked displays resolve less detail away from where the viewer looks, so pixel sizes are scaled down with
+    // distance from the gaze point before band classification
+    struct Foveation {
+        glm::vec2 gaze_point_px = glm::vec2(0.0f);
+        // full detail within this distance of the gaze point
+        float foveal_radius_px = 100.0f;
+        // distance over which the scale falls from 1 to min_peripheral_scale past the foveal radius
+        float falloff_px = 400.0f;
+        float min_peripheral_scale = 0.25f;
+    };
+
+    // objects whose smallest projected side is at least cull_threshold_px are fully opaque, below it they fade out
+    // linearly over fade_range_px and are culled once the fade reaches zero. with no range the threshold is a hard
+    // cut, with a range the threshold can be raised without objects visibly popping
+    struct ContributionFade {
+        float cull_threshold_px = 1.0f;
+        float fade_range_px = 0.0f;
+    };
+
+    // everything the projection needs, read from the camera once per batch so the per object loop never goes back
+    // through the camera interface
+    struct SizingSnapshot {
+        glm::mat4 view_projection;
+        float screen_width_px;
+        float screen_height_px;
+        // dotted with a homogeneous world position gives its distance in front of the camera
+        glm::vec4 view_depth_row = glm::vec4(0.0f);
+        // how many pixels a world space length covers when seen face on at a depth of one unit
+        float pixels_per_unit_at_unit_depth = 0.0f;
+        // when set, boxes entirely on the negative side of the world space plane (xyz normal, w offset) are culled
+        bool has_clip_plane = false;
+        glm::vec4 clip_plane = glm::vec4(0.0f);
+        bool has_foveation = false;
+        Foveation foveation;
+        ContributionFade contribution_fade;
+    };
+
+    struct SizingResult {
+        AABB2D pixel_bounding_box;
+        // smallest side of the pixel rect, what visibility culls should test
+        float min_pixel_dimension = 0.0f;
+        // min_pixel_dimension scaled down by foveation when the snapshot has a gaze point, size is classified from this
+        float classified_pixel_dimension = 0.0f;
+        // false when the projected box lies entirely outside the screen, as opposed to merely being tiny
+        bool on_screen = false;
+        Size size = Size::Small;
+        // 1 when fully visible, 0 when off screen or culled for being too small
+        float fade = 0.0f;
+        // distance range of the box in front of the camera, along the view direction
+        float min_depth = 0.0f;
+        float max_depth = 0.0f;
+    };
+
     explicit ScreenSpaceSizer(const ICamera &cam, const unsigned int &screen_width_px,
                               const unsigned int &screen_height_px)
         : camera(cam), screen_width_px(screen_width_px), screen_height_px(screen_height_px) {}
@@ -21,12 +131,14 @@ class ScreenSpaceSizer {
         // float pixel_area = compute_screen_pixel_area(local_aabb, transform);
         AABB2D pixel_bounding_box = compute_pixel_bounding_box(aabb, transform);
 
-        float min_pixel_dimension = pixel_bounding_box.min_dimension();
+        return classify_min_pixel_dimension(pixel_bounding_box.min_dimension());
+    }
 
-        if (min_pixel_dimension > 10.0f)
+    static Size classify_min_pixel_dimension(float min_pixel_dimension) {
+        if (min_pixel_dimension > large_min_pixel_dimension)
             return Size::Large;
 
-        if (min_pixel_dimension > 5.0f)
+        if (min_pixel_dimension > medium_min_pixel_dimension)
             return Size::Medium;
 
         return Size::Small;
@@ -64,6 +176,243 @@ class ScreenSpaceSizer {
         }
     }
 
+    // height in pixels of one line of text laid out in label_box, the box is assumed to hold line_count lines stacked
+    // along its height
+    float get_projected_glyph_height_px(const vertex_geometry::AxisAlignedBoundingBox &label_box, Transform &transform,
+                                        unsigned int line_count = 1) const {
+        return get_projected_glyph_height_px(take_snapshot(), label_box, transform.get_transform_matrix(), line_count);
+    }
+
+    // measured from the unclamped projection so a label partly off screen keeps its real glyph size, the clamped rect
+    // only decides visibility. zero when the label is off screen or crosses the camera plane, where there is no
+    // meaningful glyph size
+    static float get_projected_glyph_height_px(const SizingSnapshot &snapshot,
+                                               const vertex_geometry::AxisAlignedBoundingBox &label_box,
+                                               const glm::mat4 &model, unsigned int line_count = 1) {
+        if (!compute_sizing_result(snapshot, label_box, model).on_screen)
+            return 0.0f;
+
+        glm::mat4 model_view_projection = snapshot.view_projection * model;
+        float min_y = std::numeric_limits<float>::max();
+        float max_y = std::numeric_limits<float>::lowest();
+        for (const auto &c : label_box.get_corners()) {
+            glm::vec4 clip = model_view_projection * glm::vec4(c, 1.0f);
+            if (clip.w <= std::numeric_limits<float>::epsilon())
+                return 0.0f;
+            float y = (1.0f - (clip.y / clip.w * 0.5f + 0.5f)) * snapshot.screen_height_px;
+            min_y = std::min(min_y, y);
+            max_y = std::max(max_y, y);
+        }
+        return (max_y - min_y) / static_cast<float>(std::max(1u, line_count));
+    }
+
+    void set_foveation(const Foveation &foveation) {
+        this->foveation = foveation;
+        has_foveation = true;
+    }
+
+    void clear_foveation() { has_foveation = false; }
+
+    void set_contribution_fade(const ContributionFade &contribution_fade) {
+        this->contribution_fade = contribution_fade;
+    }
+
+    static float get_contribution_fade(const ContributionFade &contribution_fade, float min_pixel_dimension) {
+        float above_threshold_px = min_pixel_dimension - contribution_fade.cull_threshold_px;
+        if (contribution_fade.fade_range_px <= 0.0f)
+            return above_threshold_px >= 0.0f ? 1.0f : 0.0f;
+        return std::clamp(1.0f + above_threshold_px / contribution_fade.fade_range_px, 0.0f, 1.0f);
+    }
+
+    unsigned int get_screen_width_px() const { return screen_width_px; }
+    unsigned int get_screen_height_px() const { return screen_height_px; }
+
+    SizingSnapshot take_snapshot() const {
+        glm::mat4 view = camera.get_view_matrix();
+        glm::mat4 projection = camera.get_projection_matrix();
+        SizingSnapshot snapshot;
+        snapshot.view_projection = projection * view;
+        snapshot.screen_width_px = static_cast<float>(screen_width_px);
+        snapshot.screen_height_px = static_cast<float>(screen_height_px);
+        snapshot.view_depth_row = get_view_depth_row(view);
+        snapshot.pixels_per_unit_at_unit_depth = projection[1][1] * snapshot.screen_height_px * 0.5f;
+        snapshot.has_foveation = has_foveation;
+        snapshot.foveation = foveation;
+        snapshot.contribution_fade = contribution_fade;
+        return snapshot;
+    }
+
+    // snapshot for a planar reflection pass: the view is mirrored about plane (normal in xyz pointing to the side the
+    // camera is on, offset in w so that dot(normal, p) + w = 0 on the plane), anything behind the mirror is clipped and
+    // the viewport is scaled down to the reflection target's resolution
+    SizingSnapshot take_mirrored_snapshot(const glm::vec4 &plane, float resolution_scale = 0.5f) const {
+        glm::vec3 normal(plane);
+        float inv_length = 1.0f / glm::length(normal);
+        normal *= inv_length;
+        float offset = plane.w * inv_length;
+
+        glm::mat4 reflection(1.0f);
+        reflection[0] = glm::vec4(1.0f - 2.0f * normal.x * normal.x, -2.0f * normal.x * normal.y,
+                                  -2.0f * normal.x * normal.z, 0.0f);
+        reflection[1] = glm::vec4(-2.0f * normal.x * normal.y, 1.0f - 2.0f * normal.y * normal.y,
+                                  -2.0f * normal.y * normal.z, 0.0f);
+        reflection[2] = glm::vec4(-2.0f * normal.x * normal.z, -2.0f * normal.y * normal.z,
+                                  1.0f - 2.0f * normal.z * normal.z, 0.0f);
+        reflection[3] = glm::vec4(-2.0f * offset * normal, 1.0f);
+
+        glm::mat4 view = camera.get_view_matrix();
+        glm::mat4 projection = camera.get_projection_matrix();
+        SizingSnapshot snapshot;
+        snapshot.view_projection = projection * view * reflection;
+        snapshot.view_depth_row = row_times_matrix(get_view_depth_row(view), reflection);
+        snapshot.screen_width_px = std::max(1.0f, std::floor(screen_width_px * resolution_scale));
+        snapshot.screen_height_px = std::max(1.0f, std::floor(screen_height_px * resolution_scale));
+        snapshot.pixels_per_unit_at_unit_depth = projection[1][1] * snapshot.screen_height_px * 0.5f;
+        snapshot.has_clip_plane = true;
+        snapshot.clip_plane = glm::vec4(normal, offset);
+        snapshot.contribution_fade = contribution_fade;
+        return snapshot;
+    }
+
+    // the batch kernel, sizes a single box against a snapshot. corners that land on or behind the camera plane can't
+    // be perspective divided meaningfully, so a box that straddles it is conservatively treated as covering the screen
+    // and one entirely behind it is off screen
+    static SizingResult compute_sizing_result(const SizingSnapshot &snapshot,
+                                              const vertex_geometry::AxisAlignedBoundingBox &box,
+                                              const glm::mat4 &model) {
+        if (snapshot.has_clip_plane && entirely_behind_plane(box, model, snapshot.clip_plane))
+            return {};
+
+        glm::mat4 model_view_projection = snapshot.view_projection * model;
+        glm::vec4 model_depth_row = row_times_matrix(snapshot.view_depth_row, model);
+
+        float min_depth = std::numeric_limits<float>::max();
+        float max_depth = std::numeric_limits<float>::lowest();
+        float min_x = std::numeric_limits<float>::max();
+        float min_y = std::numeric_limits<float>::max();
+        float max_x = std::numeric_limits<float>::lowest();
+        float max_y = std::numeric_limits<float>::lowest();
+        unsigned int corners_behind_camera = 0;
+
+        for (const auto &c : box.get_corners()) {
+            glm::vec4 corner(c, 1.0f);
+            float depth = glm::dot(model_depth_row, corner);
+            min_depth = std::min(min_depth, depth);
+            max_depth = std::max(max_depth, depth);
+
+            glm::vec4 clip = model_view_projection * corner;
+            if (clip.w <= std::numeric_limits<float>::epsilon()) {
+                ++corners_behind_camera;
+                continue;
+            }
+
+            float inv_w = 1.0f / clip.w;
+            float x = (clip.x * inv_w * 0.5f + 0.5f) * snapshot.screen_width_px;
+            float y = (1.0f - (clip.y * inv_w * 0.5f + 0.5f)) * snapshot.screen_height_px;
+
+            min_x = std::min(min_x, x);
+            max_x = std::max(max_x, x);
+            min_y = std::min(min_y, y);
+            max_y = std::max(max_y, y);
+        }
+
+        SizingResult result;
+        result.min_depth = min_depth;
+        result.max_depth = max_depth;
+        if (corners_behind_camera == 8)
+            return result;
+
+        if (corners_behind_camera > 0) {
+            result.pixel_bounding_box = {{0.0f, 0.0f}, {snapshot.screen_width_px, snapshot.screen_height_px}};
+            result.on_screen = true;
+        } else {
+            result.on_screen = max_x >= 0.0f && min_x <= snapshot.screen_width_px && max_y >= 0.0f &&
+                               min_y <= snapshot.screen_height_px;
+            result.pixel_bounding_box = {{std::clamp(min_x, 0.0f, snapshot.screen_width_px),
+                                          std::clamp(min_y, 0.0f, snapshot.screen_height_px)},
+                                         {std::clamp(max_x, 0.0f, snapshot.screen_width_px),
+                                          std::clamp(max_y, 0.0f, snapshot.screen_height_px)}};
+        }
+
+        result.min_pixel_dimension = result.pixel_bounding_box.min_dimension();
+        if (result.on_screen)
+            result.fade = get_contribution_fade(snapshot.contribution_fade, result.min_pixel_dimension);
+        result.classified_pixel_dimension = result.min_pixel_dimension;
+        if (snapshot.has_foveation)
+            result.classified_pixel_dimension *= get_foveation_scale(snapshot.foveation, result.pixel_bounding_box);
+        result.size = classify_min_pixel_dimension(result.classified_pixel_dimension);
+        return result;
+    }
+
+    // sizes every box with a single camera snapshot and hands each result to on_result(index, result) as soon as it is
+    // computed, so consumers can derive their own outputs inside the same pass instead of walking the results again
+    template <typename OnResult>
+    void for_each_sized(const std::vector<vertex_geometry::AxisAlignedBoundingBox> &aabbs,
+                        std::vector<Transform> &transforms, OnResult &&on_result) const {
+        for_each_sized(take_snapshot(), aabbs, transforms, std::forward<OnResult>(on_result));
+    }
+
+    template <typename OnResult>
+    void for_each_sized(const SizingSnapshot &snapshot,
+                        const std::vector<vertex_geometry::AxisAlignedBoundingBox> &aabbs,
+                        std::vector<Transform> &transforms, OnResult &&on_result) const {
+        std::size_t count = std::min(aabbs.size(), transforms.size());
+        for (std::size_t i = 0; i < count; ++i) {
+            on_result(i, compute_sizing_result(snapshot, aabbs[i], transforms[i].get_transform_matrix()));
+        }
+    }
+
+    std::vector<SizingResult> size_batch(const std::vector<vertex_geometry::AxisAlignedBoundingBox> &aabbs,
+                                         std::vector<Transform> &transforms) const {
+        return size_batch(take_snapshot(), aabbs, transforms);
+    }
+
+    std::vector<SizingResult> size_batch(const SizingSnapshot &snapshot,
+                                         const std::vector<vertex_geometry::AxisAlignedBoundingBox> &aabbs,
+                                         std::vector<Transform> &transforms) const {
+        PROFILE_SECTION("size batch");
+        LogSection _(global_logger, "size_batch");
+
+        std::vector<SizingResult> results(std::min(aabbs.size(), transforms.size()));
+        for_each_sized(snapshot, aabbs, transforms,
+                       [&](std::size_t i, const SizingResult &result) { results[i] = result; });
+        return results;
+    }
+
+    // same as size_batch but split across threads, each thread writes a contiguous run of results. transforms are only
+    // touched by the thread that owns their index
+    void size_batch_parallel(const SizingSnapshot &snapshot,
+                             const std::vector<vertex_geometry::AxisAlignedBoundingBox> &aabbs,
+                             std::vector<Transform> &transforms, std::vector<SizingResult> &results,
+                             unsigned int num_threads = std::thread::hardware_concurrency()) const {
+        PROFILE_SECTION("size batch parallel");
+
+        std::size_t count = std::min(aabbs.size(), transforms.size());
+        results.resize(count);
+        parallel_for_chunks(count, num_threads, [&](std::size_t begin, std::size_t end, std::size_t) {
+            for (std::size_t i = begin; i < end; ++i)
+                results[i] = compute_sizing_result(snapshot, aabbs[i], transforms[i].get_transform_matrix());
+        });
+    }
+
+    std::vector<SizingResult>
+    size_batch_parallel(const std::vector<vertex_geometry::AxisAlignedBoundingBox> &aabbs,
+                        std::vector<Transform> &transforms,
+                        unsigned int num_threads = std::thread::hardware_concurrency()) const {
+        std::vector<SizingResult> results;
+        size_batch_parallel(take_snapshot(), aabbs, transforms, results, num_threads);
+        return results;
+    }
+
+    // sizes objects as seen in a planar reflection, so the reflection pass can drop everything that is behind the
+    // mirror, off the mirrored screen or too small at the reflection target's lower resolution
+    std::vector<SizingResult> size_batch_mirrored(const glm::vec4 &plane,
+                                                  const std::vector<vertex_geometry::AxisAlignedBoundingBox> &aabbs,
+                                                  std::vector<Transform> &transforms,
+                                                  float resolution_scale = 0.5f) const {
+        return size_batch(take_mirrored_snapshot(plane, resolution_scale), aabbs, transforms);
+    }
+
     template <draw_info::IVPLike IVPX> draw_info::IndexedVertexPositions make_screen_space_ivp(IVPX &obj) const {
         if (obj.xyz_positions.empty()) {
             return {}; // empty object
@@ -115,9 +464,23 @@ class ScreenSpaceSizer {
         return ivp;
     }
 
+    // eccentricity is measured to the nearest point of the rect, so anything touching the foveal region keeps full
+    // detail
+    static float get_foveation_scale(const Foveation &foveation, const AABB2D &rect) {
+        glm::vec2 nearest(std::clamp(foveation.gaze_point_px.x, rect.min.x, rect.max.x),
+                          std::clamp(foveation.gaze_point_px.y, rect.min.y, rect.max.y));
+        float eccentricity_px = glm::length(nearest - foveation.gaze_point_px);
+        float t = std::clamp((eccentricity_px - foveation.foveal_radius_px) / std::max(1.0f, foveation.falloff_px),
+                             0.0f, 1.0f);
+        return 1.0f + t * (foveation.min_peripheral_scale - 1.0f);
+    }
+
   private:
     const ICamera &camera;
     const unsigned int &screen_width_px, &screen_height_px;
+    bool has_foveation = false;
+    Foveation foveation;
+    ContributionFade contribution_fade;
 
     // TODO: don't need this function just need a function that takes in a mat and and a vector of vec3s and applies to
     // all of them.
@@ -141,6 +504,25 @@ class ScreenSpaceSizer {
         return corners;
     }
 
+    // the view looks down -z so the negated third row of the view matrix measures distance in front of the camera
+    static glm::vec4 get_view_depth_row(const glm::mat4 &view) {
+        return glm::vec4(-view[0][2], -view[1][2], -view[2][2], -view[3][2]);
+    }
+
+    static glm::vec4 row_times_matrix(const glm::vec4 &row, const glm::mat4 &m) {
+        return glm::vec4(glm::dot(row, m[0]), glm::dot(row, m[1]), glm::dot(row, m[2]), glm::dot(row, m[3]));
+    }
+
+    static bool entirely_behind_plane(const vertex_geometry::AxisAlignedBoundingBox &box, const glm::mat4 &model,
+                                      const glm::vec4 &plane) {
+        for (const auto &c : box.get_corners()) {
+            glm::vec3 world(model * glm::vec4(c, 1.0f));
+            if (glm::dot(glm::vec3(plane), world) + plane.w >= 0.0f)
+                return false;
+        }
+        return true;
+    }
+
     // TODO: move to vertex geom eventually.
     glm::vec2 project_to_ndc(const glm::vec3 &world_pos) const {
         glm::mat4 view = camera.get_view_matrix();
@@ -170,21 +552,6 @@ class ScreenSpaceSizer {
         return screen;
     }
 
-    struct AABB2D {
-        glm::vec2 min;
-        glm::vec2 max;
-
-        float width() const { return std::max(0.0f, max.x - min.x); }
-
-        float height() const { return std::max(0.0f, max.y - min.y); }
-
-        float area() const { return width() * height(); }
-
-        float min_dimension() const { return std::min(width(), height()); }
-
-        float max_dimension() const { return std::max(width(), height()); }
-    };
-
     AABB2D compute_pixel_bounding_box(const vertex_geometry::AxisAlignedBoundingBox &box, Transform &transform) const {
         // Get transformed corners in world space
         std::array<glm::vec3, 8> corners = get_aabb_corners_world(box, transform);
@@ -228,4 +595,1485 @@ class ScreenSpaceSizer {
     }
 };
 
+// the screen divided into square tiles, used to bin pixel rects
+struct ScreenTileGrid {
+    unsigned int tile_size_px = 1;
+    unsigned int tiles_x = 0, tiles_y = 0;
+
+    ScreenTileGrid() = default;
+    ScreenTileGrid(unsigned int screen_width_px, unsigned int screen_height_px, unsigned int tile_size_px)
+        : tile_size_px(std::max(1u, tile_size_px)),
+          tiles_x(std::max(1u, (screen_width_px + this->tile_size_px - 1) / this->tile_size_px)),
+          tiles_y(std::max(1u, (screen_height_px + this->tile_size_px - 1) / this->tile_size_px)) {}
+
+    std::size_t tile_count() const { return static_cast<std::size_t>(tiles_x) * tiles_y; }
+
+    // calls on_tile(tile_index) for every tile the rect touches, rects are expected to already be clamped to the screen
+    template <typename OnTile>
+    void for_each_tile_overlapping(const ScreenSpaceSizer::AABB2D &rect, OnTile &&on_tile) const {
+        auto to_tile = [&](float v, unsigned int tile_count) {
+            return std::min(static_cast<unsigned int>(std::max(0.0f, v)) / tile_size_px, tile_count - 1);
+        };
+        unsigned int min_x = to_tile(rect.min.x, tiles_x), max_x = to_tile(rect.max.x, tiles_x);
+        unsigned int min_y = to_tile(rect.min.y, tiles_y), max_y = to_tile(rect.max.y, tiles_y);
+        for (unsigned int y = min_y; y <= max_y; ++y) {
+            for (unsigned int x = min_x; x <= max_x; ++x) {
+                on_tile(static_cast<std::size_t>(y) * tiles_x + x);
+            }
+        }
+    }
+};
+
+// picks how often and at what skeleton detail each character is animated from how big it is on screen, so distant
+// crowds are evaluated at a fraction of the rate of characters near the camera
+class AnimationLODScheduler {
+  public:
+    struct AnimationLOD {
+        unsigned int update_interval_frames = 1; // evaluate once every n frames
+        unsigned int bone_lod = 0;               // 0 is the full skeleton, higher values drop more bones
+    };
+
+    struct RateBucket {
+        unsigned int update_interval_frames;
+        std::vector<std::size_t> due_character_indices;
+    };
+
+    struct Schedule {
+        std::vector<AnimationLOD> character_lods;
+        // only the characters due this frame, grouped by rate so each bucket can be evaluated as one batch
+        std::vector<RateBucket> rate_buckets;
+    };
+
+    AnimationLODScheduler(AnimationLOD large = {1, 0}, AnimationLOD medium = {2, 1}, AnimationLOD small = {4, 2},
+                          AnimationLOD off_screen = {8, 2})
+        : lod_per_size{large, medium, small}, off_screen_lod(off_screen) {}
+
+    AnimationLOD get_animation_lod(const ScreenSpaceSizer::SizingResult &result) const {
+        if (!result.on_screen)
+            return off_screen_lod;
+        return lod_per_size[static_cast<std::size_t>(result.size)];
+    }
+
+    Schedule schedule(const std::vector<ScreenSpaceSizer::SizingResult> &results, unsigned int frame_index) const {
+        PROFILE_SECTION("animation lod schedule");
+
+        Schedule schedule;
+        schedule.character_lods.resize(results.size());
+
+        for (std::size_t i = 0; i < results.size(); ++i) {
+            AnimationLOD lod = get_animation_lod(results[i]);
+            lod.update_interval_frames = std::max(1u, lod.update_interval_frames);
+            schedule.character_lods[i] = lod;
+
+            // offset by the character index so characters sharing a rate are spread evenly over the frames
+            if ((frame_index + i) % lod.update_interval_frames != 0)
+                continue;
+
+            auto bucket = std::find_if(schedule.rate_buckets.begin(), schedule.rate_buckets.end(), [&](const auto &b) {
+                return b.update_interval_frames == lod.update_interval_frames;
+            });
+            if (bucket == schedule.rate_buckets.end()) {
+                schedule.rate_buckets.push_back({lod.update_interval_frames, {}});
+                bucket = std::prev(schedule.rate_buckets.end());
+            }
+            bucket->due_character_indices.push_back(i);
+        }
+
+        std::sort(schedule.rate_buckets.begin(), schedule.rate_buckets.end(),
+                  [](const auto &a, const auto &b) { return a.update_interval_frames < b.update_interval_frames; });
+        return schedule;
+    }
+
+  private:
+    std::array<AnimationLOD, ScreenSpaceSizer::size_count> lod_per_size;
+    AnimationLOD off_screen_lod;
+};
+
+// turns sizing results into detail hints for simulation systems (cloth, particles, etc.) so they can spend fewer sub
+// steps on small objects and skip the ones the player can't meaningfully see at all
+class SimulationLODPolicy {
+  public:
+    struct SimulationLODHint {
+        bool simulate = true;
+        unsigned int sub_steps = 1;
+    };
+
+    struct Settings {
+        std::array<unsigned int, ScreenSpaceSizer::size_count> sub_steps_per_size = {4, 2, 1};
+        // some simulations have to keep running to stay plausible when they come back into view
+        bool simulate_off_screen = false;
+        unsigned int off_screen_sub_steps = 1;
+        // objects whose smallest projected side is below this are not simulated
+        float min_simulated_pixel_dimension = 1.0f;
+    };
+
+    SimulationLODPolicy() = default;
+    explicit SimulationLODPolicy(const Settings &settings) : settings(settings) {}
+
+    SimulationLODHint get_hint(const ScreenSpaceSizer::SizingResult &result) const {
+        if (!result.on_screen) {
+            if (!settings.simulate_off_screen)
+                return {false, 0};
+            return {true, settings.off_screen_sub_steps};
+        }
+
+        // nothing to simulate for objects the sizer has culled for contributing too little
+        if (result.fade <= 0.0f || result.min_pixel_dimension < settings.min_simulated_pixel_dimension)
+            return {false, 0};
+
+        return {true, settings.sub_steps_per_size[static_cast<std::size_t>(result.size)]};
+    }
+
+    // sizes the objects and derives their hints in the same pass, results is resized to match
+    std::vector<SimulationLODHint> compute_hints(const ScreenSpaceSizer &sizer,
+                                                 const std::vector<vertex_geometry::AxisAlignedBoundingBox> &aabbs,
+                                                 std::vector<Transform> &transforms,
+                                                 std::vector<ScreenSpaceSizer::SizingResult> &results) const {
+        PROFILE_SECTION("simulation lod hints");
+
+        std::size_t count = std::min(aabbs.size(), transforms.size());
+        std::vector<SimulationLODHint> hints(count);
+        results.resize(count);
+
+        sizer.for_each_sized(aabbs, transforms, [&](std::size_t i, const ScreenSpaceSizer::SizingResult &result) {
+            results[i] = result;
+            hints[i] = get_hint(result);
+        });
+        return hints;
+    }
+
+  private:
+    Settings settings;
+};
+
+// chooses how world space labels get rendered from their projected glyph height, so unreadable labels are skipped and
+// small ones use cheap bitmap fonts instead of paying for full text rendering
+class TextRenderTierSelector {
+  public:
+    enum class Tier { Skip, Bitmap, SDF, FullVector };
+
+    static constexpr std::size_t tier_count = 4;
+
+    struct Settings {
+        // glyph heights in pixels at which each tier starts
+        float min_bitmap_glyph_height_px = 4.0f;
+        float min_sdf_glyph_height_px = 12.0f;
+        float min_full_vector_glyph_height_px = 48.0f;
+    };
+
+    struct LabelTiers {
+        std::vector<float> glyph_heights_px;
+        std::array<std::vector<std::size_t>, tier_count> label_indices_per_tier;
+    };
+
+    TextRenderTierSelector() = default;
+    explicit TextRenderTierSelector(const Settings &settings) : settings(settings) {}
+
+    Tier get_tier(float glyph_height_px) const {
+        if (glyph_height_px >= settings.min_full_vector_glyph_height_px)
+            return Tier::FullVector;
+        if (glyph_height_px >= settings.min_sdf_glyph_height_px)
+            return Tier::SDF;
+        if (glyph_height_px >= settings.min_bitmap_glyph_height_px)
+            return Tier::Bitmap;
+        return Tier::Skip;
+    }
+
+    // line_counts may be empty in which case every label is a single line
+    LabelTiers bucket_labels(const ScreenSpaceSizer &sizer,
+                             const std::vector<vertex_geometry::AxisAlignedBoundingBox> &label_boxes,
+                             std::vector<Transform> &transforms,
+                             const std::vector<unsigned int> &line_counts = {}) const {
+        PROFILE_SECTION("bucket labels");
+
+        LabelTiers tiers;
+        std::size_t count = std::min(label_boxes.size(), transforms.size());
+        tiers.glyph_heights_px.resize(count, 0.0f);
+
+        // same measurement as the single label query so both agree, off screen labels come back as zero and skip
+        ScreenSpaceSizer::SizingSnapshot snapshot = sizer.take_snapshot();
+        for (std::size_t i = 0; i < count; ++i) {
+            unsigned int line_count = i < line_counts.size() ? line_counts[i] : 1u;
+            float glyph_height_px = ScreenSpaceSizer::get_projected_glyph_height_px(
+                snapshot, label_boxes[i], transforms[i].get_transform_matrix(), line_count);
+            tiers.glyph_heights_px[i] = glyph_height_px;
+            Tier tier = glyph_height_px > 0.0f ? get_tier(glyph_height_px) : Tier::Skip;
+            tiers.label_indices_per_tier[static_cast<std::size_t>(tier)].push_back(i);
+        }
+        return tiers;
+    }
+
+  private:
+    Settings settings;
+};
+
+// greedily keeps the highest priority labels whose pixel rects don't overlap any already kept label. kept rects are
+// registered in a coarse occupancy grid so each candidate is only tested against the labels in the cells it covers,
+// keeping the pass near linear in the number of labels
+class LabelDeclutterer {
+  public:
+    explicit LabelDeclutterer(float cell_size_px = 32.0f, float padding_px = 0.0f)
+        : cell_size_px(std::max(1.0f, cell_size_px)), padding_px(padding_px) {}
+
+    // returns the indices of the labels to draw, highest priority first. labels that are off screen or have no area
+    // are never kept, priorities missing for an index count as zero
+    std::vector<std::size_t> declutter(const std::vector<ScreenSpaceSizer::SizingResult> &results,
+                                       const std::vector<float> &priorities, unsigned int screen_width_px,
+                                       unsigned int screen_height_px) {
+        PROFILE_SECTION("declutter labels");
+
+        auto priority_of = [&](std::size_t i) { return i < priorities.size() ? priorities[i] : 0.0f; };
+
+        std::vector<std::size_t> candidates;
+        candidates.reserve(results.size());
+        for (std::size_t i = 0; i < results.size(); ++i) {
+            if (results[i].on_screen && results[i].pixel_bounding_box.area() > 0.0f)
+                candidates.push_back(i);
+        }
+        std::stable_sort(candidates.begin(), candidates.end(),
+                         [&](std::size_t a, std::size_t b) { return priority_of(a) > priority_of(b); });
+
+        reset_grid(screen_width_px, screen_height_px);
+
+        std::vector<std::size_t> kept;
+        std::vector<ScreenSpaceSizer::AABB2D> kept_rects;
+        for (std::size_t candidate : candidates) {
+            ScreenSpaceSizer::AABB2D rect = results[candidate].pixel_bounding_box;
+            rect.min -= glm::vec2(padding_px, padding_px);
+            rect.max += glm::vec2(padding_px, padding_px);
+
+            CellRange range = get_cell_range(rect);
+            if (overlaps_kept(rect, range, kept_rects))
+                continue;
+
+            std::uint32_t kept_index = static_cast<std::uint32_t>(kept_rects.size());
+            kept_rects.push_back(rect);
+            kept.push_back(candidate);
+            for (unsigned int y = range.min_y; y <= range.max_y; ++y) {
+                for (unsigned int x = range.min_x; x <= range.max_x; ++x) {
+                    cells[y * cells_x + x].push_back(kept_index);
+                }
+            }
+        }
+        return kept;
+    }
+
+  private:
+    struct CellRange {
+        unsigned int min_x, min_y, max_x, max_y;
+    };
+
+    float cell_size_px;
+    float padding_px;
+    unsigned int cells_x = 0, cells_y = 0;
+    // kept across calls so the per cell vectors keep their capacity from frame to frame
+    std::vector<std::vector<std::uint32_t>> cells;
+
+    void reset_grid(unsigned int screen_width_px, unsigned int screen_height_px) {
+        cells_x = std::max(1u, static_cast<unsigned int>(std::ceil(screen_width_px / cell_size_px)));
+        cells_y = std::max(1u, static_cast<unsigned int>(std::ceil(screen_height_px / cell_size_px)));
+        cells.resize(static_cast<std::size_t>(cells_x) * cells_y);
+        for (auto &cell : cells)
+            cell.clear();
+    }
+
+    CellRange get_cell_range(const ScreenSpaceSizer::AABB2D &rect) const {
+        auto to_cell = [&](float v, unsigned int cell_count) {
+            return static_cast<unsigned int>(std::clamp(v / cell_size_px, 0.0f, static_cast<float>(cell_count - 1)));
+        };
+        return {to_cell(rect.min.x, cells_x), to_cell(rect.min.y, cells_y), to_cell(rect.max.x, cells_x),
+                to_cell(rect.max.y, cells_y)};
+    }
+
+    bool overlaps_kept(const ScreenSpaceSizer::AABB2D &rect, const CellRange &range,
+                       const std::vector<ScreenSpaceSizer::AABB2D> &kept_rects) const {
+        for (unsigned int y = range.min_y; y <= range.max_y; ++y) {
+            for (unsigned int x = range.min_x; x <= range.max_x; ++x) {
+                for (std::uint32_t kept_index : cells[y * cells_x + x]) {
+                    const auto &other = kept_rects[kept_index];
+                    if (rect.min.x < other.max.x && other.min.x < rect.max.x && rect.min.y < other.max.y &&
+                        other.min.y < rect.max.y)
+                        return true;
+                }
+            }
+        }
+        return false;
+    }
+};
+
+// culls decal volumes whose projected footprint is off screen or sub pixel and bins the rest into screen tiles, so a
+// tiled decal pass only considers the decals that can touch each tile
+class DecalTileBinner {
+  public:
+    // per tile decal lists stored compactly, the decals of tile t are
+    // decal_indices[tile_offsets[t]] .. decal_indices[tile_offsets[t + 1]]
+    struct DecalTileBins {
+        ScreenTileGrid grid;
+        std::vector<std::uint32_t> tile_offsets;
+        std::vector<std::uint32_t> decal_indices;
+        std::size_t culled_count = 0;
+    };
+
+    explicit DecalTileBinner(unsigned int tile_size_px = 16, float min_footprint_px = 1.0f)
+        : tile_size_px(tile_size_px), min_footprint_px(min_footprint_px) {}
+
+    DecalTileBins bin_decals(const ScreenSpaceSizer &sizer,
+                             const std::vector<vertex_geometry::AxisAlignedBoundingBox> &decal_boxes,
+                             std::vector<Transform> &transforms) const {
+        PROFILE_SECTION("bin decals");
+
+        DecalTileBins bins;
+        bins.grid = ScreenTileGrid(sizer.get_screen_width_px(), sizer.get_screen_height_px(), tile_size_px);
+        bins.tile_offsets.assign(bins.grid.tile_count() + 1, 0);
+
+        // first pass sizes and counts, second pass scatters into the exact sized index array
+        std::vector<std::pair<std::uint32_t, ScreenSpaceSizer::AABB2D>> kept;
+        kept.reserve(std::min(decal_boxes.size(), transforms.size()));
+        sizer.for_each_sized(decal_boxes, transforms, [&](std::size_t i, const ScreenSpaceSizer::SizingResult &result) {
+            if (!result.on_screen || result.fade <= 0.0f || result.min_pixel_dimension < min_footprint_px) {
+                ++bins.culled_count;
+                return;
+            }
+            kept.emplace_back(static_cast<std::uint32_t>(i), result.pixel_bounding_box);
+            bins.grid.for_each_tile_overlapping(result.pixel_bounding_box,
+                                                [&](std::size_t tile) { ++bins.tile_offsets[tile + 1]; });
+        });
+
+        for (std::size_t t = 1; t < bins.tile_offsets.size(); ++t)
+            bins.tile_offsets[t] += bins.tile_offsets[t - 1];
+
+        bins.decal_indices.resize(bins.tile_offsets.back());
+        std::vector<std::uint32_t> write_cursor(bins.tile_offsets.begin(), bins.tile_offsets.end() - 1);
+        for (const auto &[decal_index, rect] : kept) {
+            bins.grid.for_each_tile_overlapping(
+                rect, [&](std::size_t tile) { bins.decal_indices[write_cursor[tile]++] = decal_index; });
+        }
+        return bins;
+    }
+
+  private:
+    unsigned int tile_size_px;
+    float min_footprint_px;
+};
+
+// packs per object offscreen targets (outlines, impostor captures, portals) into one shared atlas each frame. each
+// object's pixel rect is rounded up to a power of two bucket so sizes repeat from frame to frame, then placed with a
+// shelf packer sorted by height
+class RenderTargetAtlasPacker {
+  public:
+    struct AtlasRect {
+        unsigned int x = 0, y = 0;
+        unsigned int width = 0, height = 0;
+        bool packed = false; // false when the object is off screen or didn't fit
+    };
+
+    RenderTargetAtlasPacker(unsigned int atlas_width_px, unsigned int atlas_height_px, unsigned int min_bucket_px = 8,
+                            unsigned int max_bucket_px = 512)
+        : atlas_width_px(atlas_width_px), atlas_height_px(atlas_height_px), min_bucket_px(std::max(1u, min_bucket_px)),
+          max_bucket_px(std::max(this->min_bucket_px, max_bucket_px)) {}
+
+    unsigned int round_to_bucket(float size_px) const {
+        unsigned int bucket = min_bucket_px;
+        while (bucket < size_px && bucket < max_bucket_px)
+            bucket *= 2;
+        return std::min(bucket, max_bucket_px);
+    }
+
+    std::vector<AtlasRect> pack(const std::vector<ScreenSpaceSizer::SizingResult> &results) const {
+        PROFILE_SECTION("pack render target atlas");
+
+        std::vector<AtlasRect> rects(results.size());
+        std::vector<std::size_t> order;
+        order.reserve(results.size());
+        for (std::size_t i = 0; i < results.size(); ++i) {
+            if (!results[i].on_screen || results[i].pixel_bounding_box.area() <= 0.0f)
+                continue;
+            rects[i].width = round_to_bucket(results[i].pixel_bounding_box.width());
+            rects[i].height = round_to_bucket(results[i].pixel_bounding_box.height());
+            order.push_back(i);
+        }
+
+        std::sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) {
+            if (rects[a].height != rects[b].height)
+                return rects[a].height > rects[b].height;
+            return rects[a].width > rects[b].width;
+        });
+
+        unsigned int shelf_y = 0, shelf_height = 0, cursor_x = 0;
+        for (std::size_t i : order) {
+            AtlasRect &rect = rects[i];
+            // a rect bigger than the atlas can never fit, so it must not close the current shelf either
+            if (rect.width > atlas_width_px || rect.height > atlas_height_px)
+                continue;
+            if (cursor_x + rect.width > atlas_width_px) {
+                // start a new shelf under the current one
+                shelf_y += shelf_height;
+                shelf_height = 0;
+                cursor_x = 0;
+            }
+            if (shelf_y + rect.height > atlas_height_px)
+                continue;
+
+            rect.x = cursor_x;
+            rect.y = shelf_y;
+            rect.packed = true;
+            cursor_x += rect.width;
+            shelf_height = std::max(shelf_height, rect.height);
+        }
+        return rects;
+    }
+
+  private:
+    unsigned int atlas_width_px, atlas_height_px;
+    unsigned int min_bucket_px, max_bucket_px;
+};
+
+// builds back to front sort keys for visible transparent objects inside the sizing pass and sorts them with a parallel
+// lsd radix sort, so ordering transparent objects is a few linear passes over compact keys
+class TransparentSortKeys {
+  public:
+    struct SortEntry {
+        // bits 63..32 inverted depth (farthest first), 31..30 size band, 29..0 material id
+        std::uint64_t key;
+        std::uint32_t object_index;
+    };
+
+    static constexpr std::uint32_t material_id_mask = (1u << 30) - 1;
+
+    static std::uint64_t make_sort_key(float depth, ScreenSpaceSizer::Size size, std::uint32_t material_id) {
+        // the bit pattern of a non negative float orders the same way as its value
+        std::uint32_t depth_bits = std::bit_cast<std::uint32_t>(std::max(0.0f, depth));
+        return (static_cast<std::uint64_t>(~depth_bits) << 32) | (static_cast<std::uint64_t>(size) << 30) |
+               (material_id & material_id_mask);
+    }
+
+    // material_ids is indexed like aabbs, objects without one use material 0
+    static std::vector<SortEntry> build_sorted(const ScreenSpaceSizer &sizer,
+                                               const std::vector<vertex_geometry::AxisAlignedBoundingBox> &aabbs,
+                                               std::vector<Transform> &transforms,
+                                               const std::vector<std::uint32_t> &material_ids,
+                                               unsigned int num_threads = std::thread::hardware_concurrency()) {
+        PROFILE_SECTION("transparent sort keys");
+
+        std::vector<SortEntry> entries;
+        entries.reserve(std::min(aabbs.size(), transforms.size()));
+        sizer.for_each_sized(aabbs, transforms, [&](std::size_t i, const ScreenSpaceSizer::SizingResult &result) {
+            // an orthographic projection keeps w at 1, so the kernel can't flag boxes behind the camera; their depth
+            // range can
+            if (!result.on_screen || result.fade <= 0.0f || result.max_depth <= 0.0f)
+                return;
+            float center_depth = 0.5f * (result.min_depth + result.max_depth);
+            std::uint32_t material_id = i < material_ids.size() ? material_ids[i] : 0;
+            entries.push_back({make_sort_key(center_depth, result.size, material_id), static_cast<std::uint32_t>(i)});
+        });
+
+        parallel_radix_sort(entries, num_threads);
+        return entries;
+    }
+
+    // stable ascending sort by key. each thread histograms and scatters its own contiguous chunk, byte passes where
+    // every key agrees are skipped
+    static void parallel_radix_sort(std::vector<SortEntry> &entries,
+                                    unsigned int num_threads = std::thread::hardware_concurrency()) {
+        PROFILE_SECTION("parallel radix sort");
+
+        constexpr std::size_t radix = 256;
+        constexpr std::size_t min_entries_per_thread = 4096;
+
+        std::size_t count = entries.size();
+        if (count < 2)
+            return;
+
+        std::uint64_t differing_bits = 0;
+        for (const auto &entry : entries)
+            differing_bits |= entry.key ^ entries.front().key;
+
+        std::vector<unsigned int> passes;
+        for (unsigned int pass = 0; pass < 8; ++pass) {
+            if ((differing_bits >> (pass * 8)) & 0xff)
+                passes.push_back(pass);
+        }
+        if (passes.empty())
+            return;
+
+        std::size_t max_threads = std::max<std::size_t>(1, count / min_entries_per_thread);
+        std::size_t thread_count = std::clamp<std::size_t>(num_threads, 1, max_threads);
+        std::size_t chunk_size = (count + thread_count - 1) / thread_count;
+
+        std::vector<SortEntry> scratch(count);
+        std::vector<std::array<std::size_t, radix>> histograms(thread_count);
+        std::barrier sync(static_cast<std::ptrdiff_t>(thread_count));
+
+        auto worker = [&](std::size_t thread_index) {
+            std::size_t begin = std::min(count, thread_index * chunk_size);
+            std::size_t end = std::min(count, begin + chunk_size);
+            SortEntry *source = entries.data();
+            SortEntry *destination = scratch.data();
+
+            for (unsigned int pass : passes) {
+                unsigned int shift = pass * 8;
+                auto &histogram = histograms[thread_index];
+                histogram.fill(0);
+                for (std::size_t i = begin; i < end; ++i)
+                    ++histogram[(source[i].key >> shift) & 0xff];
+
+                sync.arrive_and_wait();
+
+                // where this thread's run of each digit starts: all smaller digits from every thread, then the same
+                // digit from earlier threads
+                std::array<std::size_t, radix> offsets;
+                std::size_t running = 0;
+                for (std::size_t digit = 0; digit < radix; ++digit) {
+                    for (std::size_t t = 0; t < thread_count; ++t) {
+                        if (t == thread_index)
+                            offsets[digit] = running;
+                        running += histograms[t][digit];
+                    }
+                }
+
+                for (std::size_t i = begin; i < end; ++i)
+                    destination[offsets[(source[i].key >> shift) & 0xff]++] = source[i];
+
+                sync.arrive_and_wait();
+                std::swap(source, destination);
+            }
+        };
+
+        std::vector<std::thread> threads;
+        for (std::size_t t = 1; t < thread_count; ++t)
+            threads.emplace_back(worker, t);
+        worker(0);
+        for (auto &thread : threads)
+            thread.join();
+
+        if (passes.size() % 2 == 1)
+            entries.swap(scratch);
+    }
+};
+
+// gathers the visible objects that size out as Small into one instanced batch per material, each small object then
+// costs an instance instead of its own draw call
+class SmallObjectBatcher {
+  public:
+    struct InstancedBatch {
+        std::uint32_t material_id;
+        std::vector<std::size_t> object_indices;
+        std::vector<glm::mat4> instance_transforms; // model matrices, parallel to object_indices
+    };
+
+    // material_ids is indexed like aabbs, objects without one use material 0. batches come out ordered by material id
+    static std::vector<InstancedBatch> build_batches(const ScreenSpaceSizer &sizer,
+                                                     const std::vector<vertex_geometry::AxisAlignedBoundingBox> &aabbs,
+                                                     std::vector<Transform> &transforms,
+                                                     const std::vector<std::uint32_t> &material_ids) {
+        PROFILE_SECTION("build small object batches");
+
+        std::vector<std::pair<std::uint32_t, std::size_t>> small_objects;
+        sizer.for_each_sized(aabbs, transforms, [&](std::size_t i, const ScreenSpaceSizer::SizingResult &result) {
+            if (result.on_screen && result.fade > 0.0f && result.size == ScreenSpaceSizer::Size::Small)
+                small_objects.emplace_back(i < material_ids.size() ? material_ids[i] : 0, i);
+        });
+        std::sort(small_objects.begin(), small_objects.end());
+
+        std::vector<InstancedBatch> batches;
+        for (const auto &[material_id, object_index] : small_objects) {
+            if (batches.empty() || batches.back().material_id != material_id)
+                batches.push_back({material_id, {}, {}});
+            batches.back().object_indices.push_back(object_index);
+            batches.back().instance_transforms.push_back(transforms[object_index].get_transform_matrix());
+        }
+        return batches;
+    }
+};
+
+// predicts how many layers of geometry pile up in each screen tile by conservatively rasterizing every drawn pixel
+// rect (faded out objects aren't drawn) into a small counter grid, so heavily layered areas can fall back to cheaper
+// shaders. each thread fills its own grid and the grids are summed at the end
+class OverdrawEstimator {
+  public:
+    struct OverdrawEstimate {
+        ScreenTileGrid grid;
+        std::vector<std::uint32_t> layer_counts; // per tile, row major
+        std::uint32_t max_layer_count = 0;
+    };
+
+    explicit OverdrawEstimator(unsigned int tile_size_px = 32) : tile_size_px(tile_size_px) {}
+
+    OverdrawEstimate estimate(const std::vector<ScreenSpaceSizer::SizingResult> &results, unsigned int screen_width_px,
+                              unsigned int screen_height_px,
+                              unsigned int num_threads = std::thread::hardware_concurrency()) const {
+        PROFILE_SECTION("estimate overdraw");
+
+        OverdrawEstimate estimate;
+        estimate.grid = ScreenTileGrid(screen_width_px, screen_height_px, tile_size_px);
+
+        std::size_t thread_count = std::max(1u, num_threads);
+        std::vector<std::vector<std::uint32_t>> thread_counts(thread_count);
+
+        parallel_for_chunks(results.size(), num_threads, [&](std::size_t begin, std::size_t end, std::size_t thread) {
+            auto &counts = thread_counts[thread];
+            counts.assign(estimate.grid.tile_count(), 0);
+            for (std::size_t i = begin; i < end; ++i) {
+                const auto &result = results[i];
+                // the kernel only spots boxes behind the camera through w, which an orthographic projection keeps at
+                // 1, so the depth range is checked here as well
+                if (result.fade <= 0.0f || result.max_depth <= 0.0f || result.pixel_bounding_box.area() <= 0.0f)
+                    continue;
+                estimate.grid.for_each_tile_overlapping(result.pixel_bounding_box,
+                                                        [&](std::size_t tile) { ++counts[tile]; });
+            }
+        });
+
+        estimate.layer_counts.assign(estimate.grid.tile_count(), 0);
+        for (const auto &counts : thread_counts) {
+            for (std::size_t tile = 0; tile < counts.size(); ++tile)
+                estimate.layer_counts[tile] += counts[tile];
+        }
+        if (!estimate.layer_counts.empty())
+            estimate.max_layer_count = *std::max_element(estimate.layer_counts.begin(), estimate.layer_counts.end());
+        return estimate;
+    }
+
+  private:
+    unsigned int tile_size_px;
+};
+
+// writes gpu driven indirect draw records straight out of the sizing pass, grouped by lod. consecutive objects that
+// share a mesh and lod are folded into one instanced command, so sorting objects by mesh beforehand pays off directly
+class IndirectDrawBuilder {
+  public:
+    // same layout as DrawElementsIndirectCommand
+    struct DrawElementsIndirectCommand {
+        std::uint32_t count;
+        std::uint32_t instance_count;
+        std::uint32_t first_index;
+        std::int32_t base_vertex;
+        std::uint32_t base_instance;
+    };
+
+    struct LODIndexRange {
+        std::uint32_t first_index = 0;
+        std::uint32_t index_count = 0;
+        std::int32_t base_vertex = 0;
+    };
+
+    // where each lod of one mesh lives in the shared index and vertex buffers, indexed by ScreenSpaceSizer::Size
+    using MeshLODRanges = std::array<LODIndexRange, ScreenSpaceSizer::size_count>;
+
+    // base_instance of each command indexes into the instance transforms of the same lod
+    struct IndirectDrawLists {
+        std::array<std::vector<DrawElementsIndirectCommand>, ScreenSpaceSizer::size_count> commands_per_lod;
+        std::array<std::vector<glm::mat4>, ScreenSpaceSizer::size_count> instance_transforms_per_lod;
+    };
+
+    // describes lods that are appended one after another to shared buffers, advancing the cursors past them. lods is
+    // indexed by ScreenSpaceSizer::Size
+    template <draw_info::IVPLike IVPX>
+    static MeshLODRanges append_mesh_lods(const std::array<const IVPX *, ScreenSpaceSizer::size_count> &lods,
+                                          std::uint32_t &index_cursor, std::int32_t &vertex_cursor) {
+        MeshLODRanges ranges;
+        for (std::size_t lod = 0; lod < lods.size(); ++lod) {
+            ranges[lod] = {index_cursor, static_cast<std::uint32_t>(lods[lod]->indices.size()), vertex_cursor};
+            index_cursor += static_cast<std::uint32_t>(lods[lod]->indices.size());
+            vertex_cursor += static_cast<std::int32_t>(lods[lod]->xyz_positions.size());
+        }
+        return ranges;
+    }
+
+    // mesh_ids is indexed like aabbs and selects the entry of mesh_lod_ranges each object draws, objects that are off
+    // screen or below the sizer's contribution cull threshold are dropped
+    static IndirectDrawLists build(const ScreenSpaceSizer &sizer,
+                                   const std::vector<vertex_geometry::AxisAlignedBoundingBox> &aabbs,
+                                   std::vector<Transform> &transforms, const std::vector<std::uint32_t> &mesh_ids,
+                                   const std::vector<MeshLODRanges> &mesh_lod_ranges) {
+        PROFILE_SECTION("build indirect draws");
+
+        IndirectDrawLists lists;
+        std::array<std::uint32_t, ScreenSpaceSizer::size_count> last_mesh_id;
+        last_mesh_id.fill(std::numeric_limits<std::uint32_t>::max());
+
+        sizer.for_each_sized(aabbs, transforms, [&](std::size_t i, const ScreenSpaceSizer::SizingResult &result) {
+            if (!result.on_screen || result.fade <= 0.0f || i >= mesh_ids.size() ||
+                mesh_ids[i] >= mesh_lod_ranges.size())
+                return;
+
+            std::size_t lod = static_cast<std::size_t>(result.size);
+            std::uint32_t mesh_id = mesh_ids[i];
+            auto &commands = lists.commands_per_lod[lod];
+            auto &instances = lists.instance_transforms_per_lod[lod];
+            std::uint32_t instance_index = static_cast<std::uint32_t>(instances.size());
+
+            instances.push_back(transforms[i].get_transform_matrix());
+
+            if (!commands.empty() && last_mesh_id[lod] == mesh_id) {
+                ++commands.back().instance_count;
+                return;
+            }
+
+            const LODIndexRange &range = mesh_lod_ranges[mesh_id][lod];
+            commands.push_back({range.index_count, 1, range.first_index, range.base_vertex, instance_index});
+            last_mesh_id[lod] = mesh_id;
+        });
+        return lists;
+    }
+};
+
+// picks the cut through a hierarchical lod tree to draw this frame: a node's merged proxy is drawn when its geometric
+// error projects to less than the tolerance in pixels, otherwise its children are considered instead. the cut is
+// remembered and next frame's search starts from it, coarsening and refining locally rather than from the roots
+class HLODCutSelector {
+  public:
+    struct HLODNode {
+        vertex_geometry::AxisAlignedBoundingBox world_bounds;
+        // world space deviation of this node's proxy from the full detail geometry below it
+        float geometric_error = 0.0f;
+        std::int32_t parent = -1;
+        std::vector<std::uint32_t> children;
+    };
+
+    explicit HLODCutSelector(float tolerance_px = 1.0f) : tolerance_px(tolerance_px) {}
+
+    // forgets the previous cut, the next selection walks down from the roots
+    void reset() { frontier.clear(); }
+
+    // returns the nodes to draw. the frontier also tracks off screen nodes so they can come back into view without a
+    // full traversal, they are just not drawn
+    const std::vector<std::uint32_t> &select_cut(const ScreenSpaceSizer &sizer, const std::vector<HLODNode> &nodes,
+                                                 const std::vector<std::uint32_t> &roots) {
+        PROFILE_SECTION("select hlod cut");
+
+        snapshot = sizer.take_snapshot();
+        if (node_state.size() != nodes.size()) {
+            node_state.assign(nodes.size(), {});
+            frontier.clear();
+        }
+        ++frame;
+
+        std::vector<std::uint32_t> starts;
+        if (frontier.empty()) {
+            starts = roots;
+        } else {
+            // coarsen: climb from each frontier node while the parent alone is good enough
+            for (std::uint32_t node : frontier) {
+                while (nodes[node].parent >= 0 && is_sufficient(nodes, static_cast<std::uint32_t>(nodes[node].parent)))
+                    node = static_cast<std::uint32_t>(nodes[node].parent);
+                if (node_state[node].start_stamp != frame) {
+                    node_state[node].start_stamp = frame;
+                    starts.push_back(node);
+                }
+            }
+            // with non monotonic errors one start can end up inside another's subtree, keep only the outer one
+            std::erase_if(starts, [&](std::uint32_t node) {
+                for (std::int32_t a = nodes[node].parent; a >= 0; a = nodes[a].parent) {
+                    if (node_state[a].start_stamp == frame)
+                        return true;
+                }
+                return false;
+            });
+        }
+
+        frontier.clear();
+        visible_nodes.clear();
+        for (std::uint32_t start : starts)
+            refine(nodes, start);
+        return visible_nodes;
+    }
+
+  private:
+    struct NodeState {
+        std::uint64_t sized_stamp = 0;
+        std::uint64_t start_stamp = 0;
+        bool on_screen = false;
+        bool sufficient = false;
+    };
+
+    float tolerance_px;
+    ScreenSpaceSizer::SizingSnapshot snapshot{};
+    std::uint64_t frame = 0;
+    std::vector<NodeState> node_state;
+    std::vector<std::uint32_t> frontier;
+    std::vector<std::uint32_t> visible_nodes;
+
+    // sizes a node at most once per frame
+    const NodeState &evaluate(const std::vector<HLODNode> &nodes, std::uint32_t index) {
+        NodeState &state = node_state[index];
+        if (state.sized_stamp == frame)
+            return state;
+
+        const HLODNode &node = nodes[index];
+        ScreenSpaceSizer::SizingResult result =
+            ScreenSpaceSizer::compute_sizing_result(snapshot, node.world_bounds, glm::mat4(1.0f));
+        float depth = std::max(result.min_depth, std::numeric_limits<float>::epsilon());
+        float error_px = node.geometric_error * snapshot.pixels_per_unit_at_unit_depth / depth;
+
+        state.sized_stamp = frame;
+        state.on_screen = result.on_screen;
+        state.sufficient = !result.on_screen || error_px <= tolerance_px || node.children.empty();
+        return state;
+    }
+
+    bool is_sufficient(const std::vector<HLODNode> &nodes, std::uint32_t index) {
+        return evaluate(nodes, index).sufficient;
+    }
+
+    void refine(const std::vector<HLODNode> &nodes, std::uint32_t index) {
+        const NodeState &state = evaluate(nodes, index);
+        if (state.sufficient) {
+            frontier.push_back(index);
+            if (state.on_screen)
+                visible_nodes.push_back(index);
+            return;
+        }
+        for (std::uint32_t child : nodes[index].children)
+            refine(nodes, child);
+    }
+};
+
+// maps screen footprint to a shader permutation tier so expensive shading (parallax, subsurface, layered materials) is
+// only paid for on objects big enough to show it
+class MaterialLODSelector {
+  public:
+    enum class Tier { Full, Reduced, Simple };
+
+    static constexpr std::size_t tier_count = 3;
+
+    struct Settings {
+        // smallest projected side in pixels at which each tier starts
+        float min_full_tier_px = 64.0f;
+        float min_reduced_tier_px = 16.0f;
+    };
+
+    struct MaterialLODs {
+        std::vector<ScreenSpaceSizer::Size> sizes;
+        std::vector<Tier> tiers;
+        // drawn objects (on screen and not faded out) grouped by band then tier, each group can be drawn with one
+        // pipeline and mesh lod
+        std::array<std::array<std::vector<std::size_t>, tier_count>, ScreenSpaceSizer::size_count> groups;
+    };
+
+    MaterialLODSelector() = default;
+    explicit MaterialLODSelector(const Settings &settings) : settings(settings) {}
+
+    Tier get_tier(float min_pixel_dimension) const {
+        if (min_pixel_dimension >= settings.min_full_tier_px)
+            return Tier::Full;
+        if (min_pixel_dimension >= settings.min_reduced_tier_px)
+            return Tier::Reduced;
+        return Tier::Simple;
+    }
+
+    MaterialLODs select(const ScreenSpaceSizer &sizer,
+                        const std::vector<vertex_geometry::AxisAlignedBoundingBox> &aabbs,
+                        std::vector<Transform> &transforms) const {
+        PROFILE_SECTION("select material lods");
+
+        std::size_t count = std::min(aabbs.size(), transforms.size());
+        MaterialLODs lods;
+        lods.sizes.resize(count, ScreenSpaceSizer::Size::Small);
+        lods.tiers.resize(count, Tier::Simple);
+
+        sizer.for_each_sized(aabbs, transforms, [&](std::size_t i, const ScreenSpaceSizer::SizingResult &result) {
+            Tier tier = get_tier(result.classified_pixel_dimension);
+            lods.sizes[i] = result.size;
+            lods.tiers[i] = tier;
+            if (result.fade > 0.0f)
+                lods.groups[static_cast<std::size_t>(result.size)][static_cast<std::size_t>(tier)].push_back(i);
+        });
+        return lods;
+    }
+
+  private:
+    Settings settings;
+};
+
+// caps how many objects may change lod band per frame so a camera cut doesn't trigger thousands of mesh uploads at
+// once. the swaps whose on screen coverage changed the most go first, the rest keep their current band and are retried
+// next frame
+class LODSwapLimiter {
+  public:
+    struct FrameCounters {
+        std::size_t requested_swaps = 0;
+        std::size_t committed_swaps = 0;
+        std::size_t deferred_swaps = 0;
+    };
+
+    explicit LODSwapLimiter(std::size_t max_swaps_per_frame = 256) : max_swaps_per_frame(max_swaps_per_frame) {}
+
+    // results holds this frame's sizing for the same objects in the same order every frame, returns the band each
+    // object should actually use. objects seen for the first time take their band immediately
+    const std::vector<ScreenSpaceSizer::Size> &update(const std::vector<ScreenSpaceSizer::SizingResult> &results) {
+        PROFILE_SECTION("limit lod swaps");
+
+        std::size_t known_count = std::min(committed_sizes.size(), results.size());
+        committed_sizes.resize(results.size());
+        committed_areas.resize(results.size());
+        for (std::size_t i = known_count; i < results.size(); ++i)
+            commit(i, results[i]);
+
+        pending.clear();
+        for (std::size_t i = 0; i < known_count; ++i) {
+            if (results[i].size != committed_sizes[i])
+                pending.push_back({std::abs(results[i].pixel_bounding_box.area() - committed_areas[i]), i});
+        }
+
+        counters = {};
+        counters.requested_swaps = pending.size();
+        if (pending.size() > max_swaps_per_frame) {
+            auto cut = pending.begin() + static_cast<std::ptrdiff_t>(max_swaps_per_frame);
+            std::nth_element(pending.begin(), cut, pending.end(),
+                             [](const auto &a, const auto &b) { return a.coverage_change > b.coverage_change; });
+            pending.erase(cut, pending.end());
+        }
+        for (const auto &swap : pending)
+            commit(swap.object_index, results[swap.object_index]);
+
+        counters.committed_swaps = pending.size();
+        counters.deferred_swaps = counters.requested_swaps - counters.committed_swaps;
+        return committed_sizes;
+    }
+
+    const FrameCounters &get_frame_counters() const { return counters; }
+
+    void set_max_swaps_per_frame(std::size_t max_swaps) { max_swaps_per_frame = max_swaps; }
+
+  private:
+    struct PendingSwap {
+        float coverage_change;
+        std::size_t object_index;
+    };
+
+    std::size_t max_swaps_per_frame;
+    std::vector<ScreenSpaceSizer::Size> committed_sizes;
+    // pixel area at the time of each object's last swap, the priority is how far coverage has moved since
+    std::vector<float> committed_areas;
+    std::vector<PendingSwap> pending;
+    FrameCounters counters;
+
+    void commit(std::size_t i, const ScreenSpaceSizer::SizingResult &result) {
+        committed_sizes[i] = result.size;
+        committed_areas[i] = result.pixel_bounding_box.area();
+    }
+};
+
+// per object sizing state for features that need memory across frames (hysteresis, caching, time slicing,
+// prediction). state lives in dense parallel arrays that batch passes walk front to back, objects are referred to by
+// generational handles that stay valid while other objects are inserted and removed, removal swaps the last object
+// into the hole to keep the arrays dense
+class SizingStateStore {
+  public:
+    struct Handle {
+        std::uint32_t slot = 0;
+        std::uint32_t generation = 0; // generation 0 is never issued, so a default handle is always invalid
+    };
+
+    Handle insert(const vertex_geometry::AxisAlignedBoundingBox &bounds,
+                  const glm::mat4 &model_matrix = glm::mat4(1.0f)) {
+        std::uint32_t slot;
+        if (!free_slots.empty()) {
+            slot = free_slots.back();
+            free_slots.pop_back();
+        } else {
+            slot = static_cast<std::uint32_t>(slots.size());
+            slots.push_back({0, 0});
+        }
+        ++slots[slot].generation;
+        slots[slot].dense_index = static_cast<std::uint32_t>(dense_to_slot.size());
+
+        dense_to_slot.push_back(slot);
+        local_bounds.push_back(bounds);
+        model_matrices.push_back(model_matrix);
+        pixel_bounds.push_back({glm::vec2(0.0f), glm::vec2(0.0f)});
+        sizes.push_back(ScreenSpaceSizer::Size::Small);
+        bounds_versions.push_back(0);
+        last_sized_frames.push_back(0);
+        return {slot, slots[slot].generation};
+    }
+
+    bool remove(Handle handle) {
+        if (!is_valid(handle))
+            return false;
+
+        std::uint32_t dense_index = slots[handle.slot].dense_index;
+        std::uint32_t last = static_cast<std::uint32_t>(dense_to_slot.size() - 1);
+        if (dense_index != last) {
+            dense_to_slot[dense_index] = dense_to_slot[last];
+            local_bounds[dense_index] = local_bounds[last];
+            model_matrices[dense_index] = model_matrices[last];
+            pixel_bounds[dense_index] = pixel_bounds[last];
+            sizes[dense_index] = sizes[last];
+            bounds_versions[dense_index] = bounds_versions[last];
+            last_sized_frames[dense_index] = last_sized_frames[last];
+            slots[dense_to_slot[dense_index]].dense_index = dense_index;
+        }
+        dense_to_slot.pop_back();
+        local_bounds.pop_back();
+        model_matrices.pop_back();
+        pixel_bounds.pop_back();
+        sizes.pop_back();
+        bounds_versions.pop_back();
+        last_sized_frames.pop_back();
+
+        // bumping the generation here invalidates every outstanding copy of the handle
+        ++slots[handle.slot].generation;
+        free_slots.push_back(handle.slot);
+        return true;
+    }
+
+    bool is_valid(Handle handle) const {
+        return handle.generation != 0 && handle.slot < slots.size() &&
+               slots[handle.slot].generation == handle.generation;
+    }
+
+    // position of the object in the dense arrays, only stable until the next remove
+    std::optional<std::size_t> get_dense_index(Handle handle) const {
+        if (!is_valid(handle))
+            return std::nullopt;
+        return slots[handle.slot].dense_index;
+    }
+
+    Handle get_handle(std::size_t dense_index) const {
+        std::uint32_t slot = dense_to_slot[dense_index];
+        return {slot, slots[slot].generation};
+    }
+
+    std::size_t size() const { return dense_to_slot.size(); }
+
+    void set_local_bounds(Handle handle, const vertex_geometry::AxisAlignedBoundingBox &bounds) {
+        if (auto dense_index = get_dense_index(handle)) {
+            local_bounds[*dense_index] = bounds;
+            ++bounds_versions[*dense_index];
+        }
+    }
+
+    void set_model_matrix(Handle handle, const glm::mat4 &model_matrix) {
+        if (auto dense_index = get_dense_index(handle))
+            model_matrices[*dense_index] = model_matrix;
+    }
+
+    // sizes every stored object with its stored model matrix
+    void update(const ScreenSpaceSizer &sizer, std::uint64_t frame) {
+        PROFILE_SECTION("update sizing state");
+        ScreenSpaceSizer::SizingSnapshot snapshot = sizer.take_snapshot();
+        for (std::size_t i = 0; i < dense_to_slot.size(); ++i) {
+            ScreenSpaceSizer::SizingResult result =
+                ScreenSpaceSizer::compute_sizing_result(snapshot, local_bounds[i], model_matrices[i]);
+            pixel_bounds[i] = result.pixel_bounding_box;
+            sizes[i] = result.size;
+            last_sized_frames[i] = frame;
+        }
+    }
+
+    const std::vector<vertex_geometry::AxisAlignedBoundingBox> &get_local_bounds() const { return local_bounds; }
+    const std::vector<glm::mat4> &get_model_matrices() const { return model_matrices; }
+    const std::vector<ScreenSpaceSizer::AABB2D> &get_pixel_bounds() const { return pixel_bounds; }
+    const std::vector<ScreenSpaceSizer::Size> &get_sizes() const { return sizes; }
+    const std::vector<std::uint32_t> &get_bounds_versions() const { return bounds_versions; }
+    const std::vector<std::uint64_t> &get_last_sized_frames() const { return last_sized_frames; }
+
+  private:
+    struct Slot {
+        std::uint32_t dense_index;
+        std::uint32_t generation;
+    };
+
+    std::vector<Slot> slots;
+    std::vector<std::uint32_t> free_slots;
+    std::vector<std::uint32_t> dense_to_slot;
+
+    std::vector<vertex_geometry::AxisAlignedBoundingBox> local_bounds;
+    std::vector<glm::mat4> model_matrices;
+    std::vector<ScreenSpaceSizer::AABB2D> pixel_bounds;
+    std::vector<ScreenSpaceSizer::Size> sizes;
+    std::vector<std::uint32_t> bounds_versions;
+    std::vector<std::uint64_t> last_sized_frames;
+};
+
+// opt in log of lod band changes for tuning thresholds and hysteresis. entries go into a fixed size ring that any
+// number of threads can append to without locking, old entries are overwritten once it wraps. each entry carries the
+// ring position it was written for so readers can skip entries that are mid write or already overwritten. a writer
+// claims its slot with a compare exchange, so when writers lap the ring fast enough to land on the same slot at once
+// only one of them writes it and the other entry is dropped rather than torn
+class LODChurnLog {
+  public:
+    struct Entry {
+        std::uint32_t object_id;
+        std::uint64_t frame;
+        ScreenSpaceSizer::Size old_size;
+        ScreenSpaceSizer::Size new_size;
+        float min_pixel_dimension;
+    };
+
+    struct Churner {
+        std::uint32_t object_id;
+        std::size_t change_count;
+    };
+
+    // capacity is rounded up to a power of two
+    explicit LODChurnLog(std::size_t capacity = 1 << 16) : slots(std::bit_ceil(std::max<std::size_t>(1, capacity))) {}
+
+    void set_enabled(bool enabled) { this->enabled.store(enabled, std::memory_order_relaxed); }
+    bool is_enabled() const { return enabled.load(std::memory_order_relaxed); }
+
+    void record(std::uint32_t object_id, std::uint64_t frame, ScreenSpaceSizer::Size old_size,
+                ScreenSpaceSizer::Size new_size, float min_pixel_dimension) {
+        if (!is_enabled())
+            return;
+        std::uint64_t position = write_position.fetch_add(1, std::memory_order_relaxed);
+        Slot &slot = slots[position & (slots.size() - 1)];
+        std::uint64_t current = slot.written_position.load(std::memory_order_relaxed);
+        do {
+            // another writer is in the slot or a later lap already filled it
+            if ((current & being_written) != 0 || current > position)
+                return;
+        } while (!slot.written_position.compare_exchange_weak(current, being_written | (position + 1),
+                                                              std::memory_order_relaxed));
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.entry = {object_id, frame, old_size, new_size, min_pixel_dimension};
+        slot.written_position.store(position + 1, std::memory_order_release);
+    }
+
+    // compares against the bands from the last call and logs every object whose band changed, object ids are the
+    // result indices. previous_sizes is updated in place
+    void record_changes(std::uint64_t frame, const std::vector<ScreenSpaceSizer::SizingResult> &results,
+                        std::vector<ScreenSpaceSizer::Size> &previous_sizes) {
+        std::size_t known_count = std::min(previous_sizes.size(), results.size());
+        if (is_enabled()) {
+            for (std::size_t i = 0; i < known_count; ++i) {
+                if (results[i].size != previous_sizes[i])
+                    record(static_cast<std::uint32_t>(i), frame, previous_sizes[i], results[i].size,
+                           results[i].min_pixel_dimension);
+            }
+        }
+        previous_sizes.resize(results.size());
+        for (std::size_t i = 0; i < results.size(); ++i)
+            previous_sizes[i] = results[i].size;
+    }
+
+    // the entries still in the ring, oldest first
+    std::vector<Entry> get_entries() const {
+        std::uint64_t end = write_position.load(std::memory_order_acquire);
+        std::uint64_t begin = end > slots.size() ? end - slots.size() : 0;
+
+        std::vector<Entry> entries;
+        entries.reserve(static_cast<std::size_t>(end - begin));
+        for (std::uint64_t position = begin; position < end; ++position) {
+            const Slot &slot = slots[position & (slots.size() - 1)];
+            if (slot.written_position.load(std::memory_order_acquire) != position + 1)
+                continue;
+            Entry entry = slot.entry;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.written_position.load(std::memory_order_relaxed) == position + 1)
+                entries.push_back(entry);
+        }
+        return entries;
+    }
+
+    std::vector<Churner> get_top_churners(std::size_t count) const {
+        std::unordered_map<std::uint32_t, std::size_t> change_counts;
+        for (const auto &entry : get_entries())
+            ++change_counts[entry.object_id];
+
+        std::vector<Churner> churners;
+        churners.reserve(change_counts.size());
+        for (const auto &[object_id, change_count] : change_counts)
+            churners.push_back({object_id, change_count});
+
+        count = std::min(count, churners.size());
+        std::partial_sort(churners.begin(), churners.begin() + static_cast<std::ptrdiff_t>(count), churners.end(),
+                          [](const Churner &a, const Churner &b) {
+                              if (a.change_count != b.change_count)
+                                  return a.change_count > b.change_count;
+                              return a.object_id < b.object_id;
+                          });
+        churners.resize(count);
+        return churners;
+    }
+
+    std::uint64_t get_total_recorded() const { return write_position.load(std::memory_order_relaxed); }
+
+  private:
+    // set in written_position while a writer owns the slot
+    static constexpr std::uint64_t being_written = std::uint64_t{1} << 63;
+
+    struct Slot {
+        std::atomic<std::uint64_t> written_position{0};
+        Entry entry{};
+    };
+
+    std::atomic<bool> enabled{false};
+    std::atomic<std::uint64_t> write_position{0};
+    std::vector<Slot> slots;
+};
+
+// debug images of how lod bands are spread over the screen, rasterized on the cpu from a frame's pixel rects so it
+// works in headless runs. large is green, medium yellow and small red, with coverage enabled each pixel is brightened
+// by how many rects cover it
+class BandHeatmap {
+  public:
+    struct Image {
+        unsigned int width = 0, height = 0;
+        std::vector<std::uint8_t> rgb; // row major, three bytes per pixel
+    };
+
+    static Image rasterize(const std::vector<ScreenSpaceSizer::SizingResult> &results, unsigned int width,
+                           unsigned int height, bool show_coverage = false) {
+        PROFILE_SECTION("rasterize band heatmap");
+
+        constexpr std::array<std::array<std::uint8_t, 3>, ScreenSpaceSizer::size_count> band_colors = {
+            {{{40, 200, 60}}, {{230, 200, 40}}, {{220, 50, 40}}}};
+
+        // per pixel, the smallest band covering it wins so small objects stay visible on top of large ones
+        std::vector<std::uint8_t> band(static_cast<std::size_t>(width) * height, 0xff);
+        std::vector<std::uint32_t> coverage(show_coverage ? band.size() : 0, 0);
+
+        for (const auto &result : results) {
+            if (!result.on_screen)
+                continue;
+            const auto &rect = result.pixel_bounding_box;
+            unsigned int min_x = static_cast<unsigned int>(std::clamp(rect.min.x, 0.0f, static_cast<float>(width)));
+            unsigned int min_y = static_cast<unsigned int>(std::clamp(rect.min.y, 0.0f, static_cast<float>(height)));
+            // sub pixel rects still mark the pixel they fall in
+            unsigned int max_x =
+                std::min(width, std::max(min_x + 1, static_cast<unsigned int>(std::ceil(rect.max.x))));
+            unsigned int max_y =
+                std::min(height, std::max(min_y + 1, static_cast<unsigned int>(std::ceil(rect.max.y))));
+            std::uint8_t size = static_cast<std::uint8_t>(result.size);
+
+            for (unsigned int y = min_y; y < max_y; ++y) {
+                for (unsigned int x = min_x; x < max_x; ++x) {
+                    std::size_t pixel = static_cast<std::size_t>(y) * width + x;
+                    if (band[pixel] == 0xff || size > band[pixel])
+                        band[pixel] = size;
+                    if (show_coverage)
+                        ++coverage[pixel];
+                }
+            }
+        }
+
+        std::uint32_t max_coverage = 1;
+        for (std::uint32_t count : coverage)
+            max_coverage = std::max(max_coverage, count);
+
+        Image image{width, height, std::vector<std::uint8_t>(band.size() * 3, 0)};
+        for (std::size_t pixel = 0; pixel < band.size(); ++pixel) {
+            if (band[pixel] == 0xff)
+                continue;
+            float brightness = 1.0f;
+            if (show_coverage) {
+                brightness = 0.25f + 0.75f * std::log1p(static_cast<float>(coverage[pixel])) /
+                                         std::log1p(static_cast<float>(max_coverage));
+            }
+            for (int channel = 0; channel < 3; ++channel) {
+                image.rgb[pixel * 3 + channel] =
+                    static_cast<std::uint8_t>(band_colors[band[pixel]][channel] * brightness);
+            }
+        }
+        return image;
+    }
+
+    // binary ppm, readable by most image tools without any extra dependency
+    static bool write_ppm(const Image &image, const std::string &path) {
+        std::ofstream file(path, std::ios::binary);
+        if (!file)
+            return false;
+        file << "P6\n" << image.width << " " << image.height << "\n255\n";
+        file.write(reinterpret_cast<const char *>(image.rgb.data()), static_cast<std::streamsize>(image.rgb.size()));
+        return static_cast<bool>(file);
+    }
+
+    // rasterizes and writes on a worker thread, results are copied so the frame can move on immediately. keep the
+    // future until the write is done (check it on a later frame): a future from std::async blocks in its destructor, so
+    // dropping it straight away would stall the caller for the whole write
+    [[nodiscard]] static std::future<bool> write_ppm_async(std::vector<ScreenSpaceSizer::SizingResult> results,
+                                                           unsigned int width, unsigned int height, std::string path,
+                                                           bool show_coverage = false) {
+        return std::async(std::launch::async, [results = std::move(results), width, height, path = std::move(path),
+                                               show_coverage] {
+            return write_ppm(rasterize(results, width, height, show_coverage), path);
+        });
+    }
+};
+
+// walks a transform hierarchy composing parent and child matrices on the fly and sizing as it goes. every node carries
+// bounds for its whole subtree, so a branch that is off screen or already faded out by the sizer's contribution fade
+// is dropped before any of its descendants' matrices are composed. a descendant's rect lies inside its subtree's, so
+// it can't be any bigger and would be culled too
+class SceneGraphSizer {
+  public:
+    struct SceneNode {
+        glm::mat4 local_matrix = glm::mat4(1.0f); // relative to the parent
+        bool has_geometry = false;
+        vertex_geometry::AxisAlignedBoundingBox local_bounds; // this node's own geometry in its local space
+        // this node and all of its descendants in this node's local space, see compute_subtree_bounds
+        vertex_geometry::AxisAlignedBoundingBox subtree_bounds;
+        std::vector<std::uint32_t> children;
+    };
+
+    struct SizedNode {
+        std::uint32_t node;
+        glm::mat4 world_matrix;
+        ScreenSpaceSizer::SizingResult result;
+    };
+
+    struct TraversalCounters {
+        std::size_t visited_nodes = 0;
+        std::size_t pruned_subtrees = 0;
+    };
+
+    // refreshes subtree bounds bottom up, needed whenever local matrices or bounds change. nodes without geometry
+    // and without children get an empty box at their origin
+    static void compute_subtree_bounds(std::vector<SceneNode> &nodes, const std::vector<std::uint32_t> &roots) {
+        // children are finished before their parent by processing a preorder in reverse
+        std::vector<std::uint32_t> order;
+        std::vector<std::uint32_t> stack(roots.begin(), roots.end());
+        while (!stack.empty()) {
+            std::uint32_t node = stack.back();
+            stack.pop_back();
+            order.push_back(node);
+            stack.insert(stack.end(), nodes[node].children.begin(), nodes[node].children.end());
+        }
+
+        for (auto it = order.rbegin(); it != order.rend(); ++it) {
+            SceneNode &node = nodes[*it];
+            std::vector<glm::vec3> points;
+            if (node.has_geometry) {
+                auto corners = node.local_bounds.get_corners();
+                points.insert(points.end(), corners.begin(), corners.end());
+            }
+            for (std::uint32_t child : node.children) {
+                const glm::mat4 &child_matrix = nodes[child].local_matrix;
+                for (const auto &corner : nodes[child].subtree_bounds.get_corners())
+                    points.emplace_back(child_matrix * glm::vec4(corner, 1.0f));
+            }
+            if (points.empty())
+                points.emplace_back(0.0f, 0.0f, 0.0f);
+            node.subtree_bounds = vertex_geometry::AxisAlignedBoundingBox(points);
+        }
+    }
+
+    // returns the drawn nodes with geometry together with their composed world matrices
+    std::vector<SizedNode> traverse(const ScreenSpaceSizer &sizer, const std::vector<SceneNode> &nodes,
+                                    const std::vector<std::uint32_t> &roots,
+                                    const glm::mat4 &root_matrix = glm::mat4(1.0f)) {
+        PROFILE_SECTION("scene graph traversal");
+
+        ScreenSpaceSizer::SizingSnapshot snapshot = sizer.take_snapshot();
+        counters = {};
+
+        struct Pending {
+            std::uint32_t node;
+            glm::mat4 parent_world_matrix;
+        };
+        std::vector<Pending> stack;
+        for (auto it = roots.rbegin(); it != roots.rend(); ++it)
+            stack.push_back({*it, root_matrix});
+
+        std::vector<SizedNode> sized_nodes;
+        while (!stack.empty()) {
+            Pending pending = stack.back();
+            stack.pop_back();
+            const SceneNode &node = nodes[pending.node];
+            ++counters.visited_nodes;
+
+            glm::mat4 world_matrix = pending.parent_world_matrix * node.local_matrix;
+
+            if (!node.children.empty()) {
+                ScreenSpaceSizer::SizingResult subtree =
+                    ScreenSpaceSizer::compute_sizing_result(snapshot, node.subtree_bounds, world_matrix);
+                if (subtree.fade <= 0.0f) {
+                    ++counters.pruned_subtrees;
+                    continue;
+                }
+                for (auto it = node.children.rbegin(); it != node.children.rend(); ++it)
+                    stack.push_back({*it, world_matrix});
+            }
+
+            if (node.has_geometry) {
+                ScreenSpaceSizer::SizingResult result =
+                    ScreenSpaceSizer::compute_sizing_result(snapshot, node.local_bounds, world_matrix);
+                if (result.fade > 0.0f)
+                    sized_nodes.push_back({pending.node, world_matrix, result});
+            }
+        }
+        return sized_nodes;
+    }
+
+    const TraversalCounters &get_counters() const { return counters; }
+
+  private:
+    TraversalCounters counters;
+};
+
+// approximate front to back order for opaque objects, good enough for early z. drawn objects are counting sorted
+// into a fixed number of buckets spread linearly over this frame's nearest and farthest min depth, separately for each
+// band, which is linear in the object count and needs no comparisons
+class DepthBucketer {
+  public:
+    // the objects of bucket b for a band are object_indices[offsets[b]] .. object_indices[offsets[b + 1]], bucket 0 is
+    // the nearest
+    struct BandBuckets {
+        std::vector<std::uint32_t> offsets;
+        std::vector<std::uint32_t> object_indices;
+    };
+
+    using DepthBuckets = std::array<BandBuckets, ScreenSpaceSizer::size_count>;
+
+    explicit DepthBucketer(std::size_t bucket_count = 64) : bucket_count(std::max<std::size_t>(1, bucket_count)) {}
+
+    DepthBuckets bucket(const std::vector<ScreenSpaceSizer::SizingResult> &results) const {
+        PROFILE_SECTION("depth bucketing");
+
+        float nearest = std::numeric_limits<float>::max();
+        float farthest = 0.0f;
+        for (const auto &result : results) {
+            if (!is_visible(result))
+                continue;
+            float depth = std::max(0.0f, result.min_depth);
+            nearest = std::min(nearest, depth);
+            farthest = std::max(farthest, depth);
+        }
+        float buckets_per_unit = farthest > nearest ? static_cast<float>(bucket_count) / (farthest - nearest) : 0.0f;
+
+        auto bucket_of = [&](const ScreenSpaceSizer::SizingResult &result) {
+            float depth = std::max(0.0f, result.min_depth);
+            return std::min(bucket_count - 1, static_cast<std::size_t>((depth - nearest) * buckets_per_unit));
+        };
+
+        DepthBuckets buckets;
+        for (auto &band : buckets)
+            band.offsets.assign(bucket_count + 1, 0);
+
+        for (const auto &result : results) {
+            if (is_visible(result))
+                ++buckets[static_cast<std::size_t>(result.size)].offsets[bucket_of(result) + 1];
+        }
+
+        std::array<std::vector<std::uint32_t>, ScreenSpaceSizer::size_count> write_cursors;
+        for (std::size_t size = 0; size < ScreenSpaceSizer::size_count; ++size) {
+            auto &offsets = buckets[size].offsets;
+            for (std::size_t b = 1; b < offsets.size(); ++b)
+                offsets[b] += offsets[b - 1];
+            buckets[size].object_indices.resize(offsets.back());
+            write_cursors[size].assign(offsets.begin(), offsets.end() - 1);
+        }
+
+        for (std::size_t i = 0; i < results.size(); ++i) {
+            if (!is_visible(results[i]))
+                continue;
+            std::size_t size = static_cast<std::size_t>(results[i].size);
+            buckets[size].object_indices[write_cursors[size][bucket_of(results[i])]++] = static_cast<std::uint32_t>(i);
+        }
+        return buckets;
+    }
+
+  private:
+    std::size_t bucket_count;
+
+    // objects faded out by the contribution fade are never drawn, so they take no part in the ordering. boxes behind
+    // the camera are caught by depth too since an orthographic projection keeps w at 1 and the kernel can't flag them
+    static bool is_visible(const ScreenSpaceSizer::SizingResult &result) {
+        return result.fade > 0.0f && result.max_depth > 0.0f;
+    }
+};
+
 #endif // SCREEN_SPACE_SIZER_HPP
@@ -0,0 +1,236 @@
+#ifndef SHARED_SIZING_RESULTS_RING_HPP
+#define SHARED_SIZING_RESULTS_RING_HPP
+
+#include "screen_space_sizer.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// per frame sizing results published to a posix shared memory ring so other local processes (editor tooling etc.) can
+// read lod and visibility decisions without recomputing them. each ring slot is guarded by a seqlock: the writer makes
+// its sequence odd while writing and even again when done, readers check the sequence is even and unchanged around
+// their read. the ring depth gives readers several frames before a slot they are looking at gets reused
+class SharedSizingResultsRing {
+  public:
+    static constexpr std::uint32_t magic = 0x53535a52; // "SSZR"
+    static constexpr std::uint32_t layout_version = 2;
+
+    struct Record {
+        float min_x, min_y, max_x, max_y;
+        float min_pixel_dimension;
+        // the contribution fade, zero means the object is culled
+        float fade;
+        float min_depth, max_depth;
+        std::uint8_t size;
+        std::uint8_t on_screen;
+        std::uint8_t padding[2];
+    };
+
+    struct Header {
+        std::uint32_t magic;
+        std::uint32_t layout_version;
+        std::uint32_t slot_count;
+        std::uint32_t max_objects;
+        std::uint64_t slot_stride_bytes;
+        // total frames published, the newest one lives in slot (published_count - 1) % slot_count
+        std::atomic<std::uint64_t> published_count;
+    };
+
+    struct SlotHeader {
+        std::atomic<std::uint64_t> sequence;
+        std::uint64_t frame;
+        std::uint32_t object_count;
+        std::uint32_t padding;
+    };
+
+    // a zero copy look at one published frame, only trustworthy if is_view_valid still holds after reading it
+    struct View {
+        const Record *records = nullptr;
+        std::uint32_t object_count = 0;
+        std::uint64_t frame = 0;
+        std::uint32_t slot = 0;
+        std::uint64_t sequence = 0;
+    };
+
+    static_assert(std::atomic<std::uint64_t>::is_always_lock_free, "shared memory needs address free atomics");
+
+    SharedSizingResultsRing(const SharedSizingResultsRing &) = delete;
+    SharedSizingResultsRing &operator=(const SharedSizingResultsRing &) = delete;
+
+    ~SharedSizingResultsRing() {
+        if (mapping != nullptr)
+            munmap(mapping, mapping_size);
+        if (owner)
+            shm_unlink(name.c_str());
+    }
+
+    // name follows shm_open rules, eg "/screen_space_sizer". the writer owns the segment and unlinks it on destruction.
+    // fails if the name is already taken, so a second writer can't take over and later unlink a live ring; a segment
+    // left behind by a crashed writer has to be shm_unlink'ed first
+    static std::unique_ptr<SharedSizingResultsRing> create_writer(const std::string &name, std::uint32_t max_objects,
+                                                                  std::uint32_t slot_count = 4) {
+        if (slot_count == 0)
+            return nullptr;
+        std::uint64_t slot_stride = round_up(sizeof(SlotHeader) + sizeof(Record) * std::uint64_t{max_objects});
+        std::size_t size = static_cast<std::size_t>(round_up(sizeof(Header)) + slot_stride * slot_count);
+
+        int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+        if (fd < 0)
+            return nullptr;
+        if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+            close(fd);
+            shm_unlink(name.c_str());
+            return nullptr;
+        }
+        void *mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (mapping == MAP_FAILED) {
+            shm_unlink(name.c_str());
+            return nullptr;
+        }
+
+        std::unique_ptr<SharedSizingResultsRing> ring(new SharedSizingResultsRing(name, mapping, size, true));
+        new (mapping) Header{magic, layout_version, slot_count, max_objects, slot_stride, {0}};
+        for (std::uint32_t slot = 0; slot < slot_count; ++slot)
+            new (ring->get_slot_header(slot)) SlotHeader{{0}, 0, 0, 0};
+        return ring;
+    }
+
+    static std::unique_ptr<SharedSizingResultsRing> open_reader(const std::string &name) {
+        int fd = shm_open(name.c_str(), O_RDONLY, 0);
+        if (fd < 0)
+            return nullptr;
+        struct stat info;
+        if (fstat(fd, &info) != 0 || static_cast<std::size_t>(info.st_size) < sizeof(Header)) {
+            close(fd);
+            return nullptr;
+        }
+        std::size_t size = static_cast<std::size_t>(info.st_size);
+        void *mapping = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if (mapping == MAP_FAILED)
+            return nullptr;
+
+        std::unique_ptr<SharedSizingResultsRing> ring(new SharedSizingResultsRing(name, mapping, size, false));
+        // everything publish and get_latest_view index with has to be checked here, the writer may be a different
+        // build or not ours at all
+        const Header *header = ring->get_header();
+        if (header->magic != magic || header->layout_version != layout_version || header->slot_count == 0 ||
+            header->slot_stride_bytes < sizeof(SlotHeader) + sizeof(Record) * std::uint64_t{header->max_objects} ||
+            size < round_up(sizeof(Header)) ||
+            header->slot_stride_bytes > (size - round_up(sizeof(Header))) / header->slot_count)
+            return nullptr;
+        return ring;
+    }
+
+    // writer side, results beyond max_objects are dropped
+    void publish(std::uint64_t frame, const std::vector<ScreenSpaceSizer::SizingResult> &results) {
+        PROFILE_SECTION("publish shared sizing results");
+
+        Header *header = get_header();
+        std::uint64_t published = header->published_count.load(std::memory_order_relaxed);
+        std::uint32_t slot = static_cast<std::uint32_t>(published % header->slot_count);
+        SlotHeader *slot_header = get_slot_header(slot);
+        Record *records = get_records(slot);
+
+        std::uint64_t sequence = slot_header->sequence.load(std::memory_order_relaxed);
+        slot_header->sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        std::uint32_t count = static_cast<std::uint32_t>(std::min<std::size_t>(results.size(), header->max_objects));
+        slot_header->frame = frame;
+        slot_header->object_count = count;
+        for (std::uint32_t i = 0; i < count; ++i) {
+            const auto &result = results[i];
+            records[i] = {result.pixel_bounding_box.min.x,
+                          result.pixel_bounding_box.min.y,
+                          result.pixel_bounding_box.max.x,
+                          result.pixel_bounding_box.max.y,
+                          result.min_pixel_dimension,
+                          result.fade,
+                          result.min_depth,
+                          result.max_depth,
+                          static_cast<std::uint8_t>(result.size),
+                          static_cast<std::uint8_t>(result.on_screen),
+                          {0, 0}};
+        }
+
+        slot_header->sequence.store(sequence + 2, std::memory_order_release);
+        header->published_count.store(published + 1, std::memory_order_release);
+    }
+
+    // reader side, false when nothing has been published yet or the writer is mid way through the newest slot
+    bool get_latest_view(View &view) const {
+        const Header *header = get_header();
+        std::uint64_t published = header->published_count.load(std::memory_order_acquire);
+        if (published == 0)
+            return false;
+
+        view.slot = static_cast<std::uint32_t>((published - 1) % header->slot_count);
+        const SlotHeader *slot_header = get_slot_header(view.slot);
+        view.sequence = slot_header->sequence.load(std::memory_order_acquire);
+        if (view.sequence % 2 == 1)
+            return false;
+
+        view.frame = slot_header->frame;
+        view.object_count = std::min(slot_header->object_count, header->max_objects);
+        view.records = get_records(view.slot);
+        return true;
+    }
+
+    bool is_view_valid(const View &view) const {
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return get_slot_header(view.slot)->sequence.load(std::memory_order_relaxed) == view.sequence;
+    }
+
+    // copies the newest frame out, retrying while the writer is in the middle of it
+    bool read_latest(std::vector<Record> &records, std::uint64_t &frame, unsigned int max_attempts = 8) const {
+        for (unsigned int attempt = 0; attempt < max_attempts; ++attempt) {
+            View view;
+            if (!get_latest_view(view))
+                continue;
+            records.assign(view.records, view.records + view.object_count);
+            frame = view.frame;
+            if (is_view_valid(view))
+                return true;
+        }
+        return false;
+    }
+
+  private:
+    std::string name;
+    void *mapping;
+    std::size_t mapping_size;
+    bool owner;
+
+    SharedSizingResultsRing(std::string name, void *mapping, std::size_t mapping_size, bool owner)
+        : name(std::move(name)), mapping(mapping), mapping_size(mapping_size), owner(owner) {}
+
+    // keeps every slot on its own cache lines
+    static std::uint64_t round_up(std::uint64_t bytes) { return (bytes + 63) / 64 * 64; }
+
+    Header *get_header() const { return static_cast<Header *>(mapping); }
+
+    SlotHeader *get_slot_header(std::uint32_t slot) const {
+        return reinterpret_cast<SlotHeader *>(static_cast<std::uint8_t *>(mapping) + round_up(sizeof(Header)) +
+                                              get_header()->slot_stride_bytes * slot);
+    }
+
+    Record *get_records(std::uint32_t slot) const { return reinterpret_cast<Record *>(get_slot_header(slot) + 1); }
+};
+
+#endif
+
+#endif // SHARED_SIZING_RESULTS_RING_HPP